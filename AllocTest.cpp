@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include "DeepFlags.hpp"
+using std::vector;
+using std::string;
+
+/*
+ * Every heap allocation made by this binary is counted by the replacement
+ * allocation functions below. DeepFlags allocates only through operator new
+ * (by way of the standard containers), so this is enough to catch any
+ * allocation on a parse path.
+ */
+static std::atomic<size_t> allocationCount(0);
+
+void *operator new(size_t size) {
+  ++allocationCount;
+  if (void *res = std::malloc(size ? size : 1)) {
+    return res;
+  }
+  throw std::bad_alloc();
+}
+
+void *operator new[](size_t size) {
+  return operator new(size);
+}
+
+void *operator new(size_t size, const std::nothrow_t&) noexcept {
+  ++allocationCount;
+  return std::malloc(size ? size : 1);
+}
+
+void *operator new[](size_t size, const std::nothrow_t&) noexcept {
+  ++allocationCount;
+  return std::malloc(size ? size : 1);
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete[](void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { std::free(ptr); }
+
+namespace AllocTest {
+
+  /// Counts the allocations made since this counter was constructed.
+  class AllocationCounter {
+    const size_t start;
+   public:
+    AllocationCounter(): start(allocationCount) {}
+    size_t count() const { return allocationCount - start; }
+  };
+
+  /// Exposes the protected hasFlag query of FlagBase.
+  struct HasFlagProbe: Flags::Internal::FlagBase {
+    using FlagBase::pHasFlag;
+  };
+
+  struct PrimitiveFlags: Flags::FlagGroup {
+    Flags::Flag<bool> alive = Flags::flag(this, "alive");
+    Flags::Flag<int64_t> param = Flags::flag(this, "param");
+    Flags::Flag<uint8_t> level = Flags::flag(this, "level", 'l');
+    Flags::Flag<double> ratio = Flags::flag(this, "ratio", 'r');
+    Flags::Flag<int32_t> longNamed =
+        Flags::flag(this, "a-name-too-long-for-small-strings");
+    Flags::Flag<std::tuple<double, int>> point = Flags::flag(this, "point");
+    Flags::Flag<std::array<uint16_t, 3>> rgb = Flags::flag(this, "rgb");
+    Flags::Switch force = Flags::flag(this, 'f');
+    Flags::Switch verbose = Flags::flag(this, 'v');
+  };
+
+  struct EntityFlags: Flags::FlagGroup {
+    Flags::Flag<int64_t> id = Flags::flag(this, "id");
+    Flags::Flag<double> x = Flags::flag(this, "x", 'x');
+    Flags::Flag<vector<int>> tags = Flags::flag(this, "entity-tag-values");
+    EntityFlags(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct NestedFlags: Flags::FlagGroup {
+    Flags::Flag<vector<EntityFlags>> entities = Flags::flag(this, "entity");
+    Flags::Flag<Flags::Repeated<EntityFlags>> others =
+        Flags::flag(this, "other", 'o');
+    Flags::Flag<vector<int>> inds = Flags::flag(this, "ind");
+  };
+
+  TEST(AllocTest, ReparsingPrimitiveGroupDoesNotAllocate) {
+    const char* argv[] = {
+      "flagstest.exe",
+      "--alive=yes",
+      "--param", "-20",
+      "-l", "0x7f",
+      "--ratio=2.5",
+      "--a-name-too-long-for-small-strings", "123456",
+      "--point", "1.5", "-2",
+      "--rgb=255", "128", "0",
+      "-fv"
+    };
+    constexpr size_t argc = sizeof(argv) / sizeof(const char*);
+
+    PrimitiveFlags flags;
+    ASSERT_TRUE(flags.parseArgs(argc, argv));
+    flags.reset();
+
+    AllocationCounter counter;
+    bool success = true;
+    for (int i = 0; i < 100; ++i) {
+      success = success && flags.parseArgs(argc, argv);
+      if (i < 99) {
+        flags.reset();
+      }
+    }
+    size_t allocations = counter.count();
+
+    ASSERT_TRUE(success);
+    EXPECT_EQ(0u, allocations);
+    EXPECT_TRUE(flags.alive.value);
+    EXPECT_EQ(-20, flags.param.value);
+    EXPECT_EQ(127, flags.level.value);
+    EXPECT_EQ(2.5, flags.ratio.value);
+    EXPECT_EQ(123456, flags.longNamed.value);
+    EXPECT_EQ(std::make_tuple(1.5, -2), flags.point.value);
+    EXPECT_EQ(0, std::get<2>(flags.rgb.value));
+    EXPECT_TRUE(flags.force.present);
+    EXPECT_TRUE(flags.verbose.present);
+  }
+
+  struct ListFlags: Flags::FlagGroup {
+    Flags::Flag<Flags::StringList> inputs = Flags::flag(this, "input");
+  };
+
+  TEST(AllocTest, ReparsingStringListDoesNotAllocate) {
+    vector<string> args = { "flagstest.exe", "--input" };
+    for (int i = 0; i < 1000; ++i) {
+      args.push_back("some/directory/input-file-" + std::to_string(i));
+    }
+    vector<const char*> argv;
+    for (const string &arg : args) {
+      argv.push_back(arg.c_str());
+    }
+
+    ListFlags flags;
+    ASSERT_TRUE(flags.parseArgs(argv.size(), argv.data()));
+    flags.reset();
+
+    AllocationCounter counter;
+    bool success = flags.parseArgs(argv.size(), argv.data());
+    size_t allocations = counter.count();
+
+    ASSERT_TRUE(success);
+    EXPECT_EQ(0u, allocations);
+    EXPECT_EQ(1000u, flags.inputs.value.size());
+    EXPECT_EQ("some/directory/input-file-999", flags.inputs.value.back());
+  }
+
+  struct StreamFlags: Flags::FlagGroup {
+    Flags::Flag<Flags::Stream<int>> ids = Flags::flag(this, "id");
+    Flags::Flag<Flags::Stream<std::string_view>> inputs =
+        Flags::flag(this, "input");
+  };
+
+  TEST(AllocTest, StreamingValuesDoesNotAllocate) {
+    vector<string> args = { "flagstest.exe", "--id" };
+    for (int i = 0; i < 1000; ++i) {
+      args.push_back(std::to_string(i));
+    }
+    args.push_back("--input");
+    for (int i = 0; i < 1000; ++i) {
+      args.push_back("some/directory/input-file-" + std::to_string(i));
+    }
+    vector<const char*> argv;
+    for (const string &arg : args) {
+      argv.push_back(arg.c_str());
+    }
+
+    StreamFlags flags;
+    long sum = 0;
+    size_t characters = 0;
+    flags.ids.onValue([&sum](int id) { sum += id; });
+    flags.inputs.onValue([&characters](std::string_view input) {
+      characters += input.length();
+    });
+
+    // Even the first parse allocates nothing, however many values it reads.
+    AllocationCounter counter;
+    bool success = flags.parseArgs(argv.size(), argv.data());
+    size_t allocations = counter.count();
+
+    ASSERT_TRUE(success);
+    EXPECT_EQ(0u, allocations);
+    EXPECT_EQ(999 * 1000 / 2, sum);
+    EXPECT_EQ(1000u, flags.inputs.count);
+    EXPECT_EQ(1000 * 26 + 10 + 90 * 2 + 900 * 3, long(characters));
+  }
+
+  TEST(AllocTest, HasFlagDoesNotAllocate) {
+    NestedFlags flags;
+    const Flags::Internal::FlagBase &group = flags;
+
+    // Misses visit every nested element type, warming up any lazy state.
+    HasFlagProbe::pHasFlag(group, "warm-up");
+    HasFlagProbe::pHasFlag(group, 'w');
+
+    AllocationCounter counter;
+    bool found = true, missing = false;
+    for (int i = 0; i < 100; ++i) {
+      found = found && HasFlagProbe::pHasFlag(group, "entity");
+      found = found && HasFlagProbe::pHasFlag(group, "id");
+      found = found && HasFlagProbe::pHasFlag(group, "entity-tag-values");
+      found = found && HasFlagProbe::pHasFlag(group, 'x');
+      found = found && HasFlagProbe::pHasFlag(group, 'o');
+      missing = missing || HasFlagProbe::pHasFlag(group, "not-a-flag-at-all");
+      missing = missing || HasFlagProbe::pHasFlag(group, 'q');
+    }
+    size_t allocations = counter.count();
+
+    EXPECT_TRUE(found);
+    EXPECT_FALSE(missing);
+    EXPECT_EQ(0u, allocations);
+  }
+}
@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+#include <chrono>
+#include <deque>
+#include <limits>
+#include "DeepFlags.hpp"
+using std::vector;
+using std::string;
+
+/*
+ * These tests parse generated inputs of 1k, 10k and 100k tokens and check that
+ * the cost per token stays roughly flat. A parse path that is quadratic in the
+ * input would cost a hundred times more per token at the largest size; the
+ * allowed slack is generous enough to absorb cache effects and timer noise.
+ */
+namespace ComplexityTest {
+
+  constexpr double kAllowedSlowdown = 8;
+  const size_t kSizes[] = { 1000, 10000, 100000 };
+
+  /// Owns generated arguments and presents them as an argv array.
+  class ArgList {
+    std::deque<string> args;
+    vector<const char*> argv;
+
+   public:
+    ArgList(): args{ "complexitytest.exe" }, argv{ args[0].c_str() } {}
+
+    void add(string arg) {
+      args.push_back(arg);
+      argv.push_back(args.back().c_str());
+    }
+
+    size_t tokens() const { return args.size() - 1; }
+    int argc() const { return argv.size(); }
+    const char* const* data() const { return argv.data(); }
+  };
+
+  /**
+   * Returns the best observed time per token, in seconds, for parsing the
+   * given arguments into a fresh instance of Group. Parses are repeated until
+   * a few milliseconds have been measured, to keep small inputs above the
+   * resolution of the clock.
+   */
+  template<typename Group> double timePerToken(const ArgList &args) {
+    typedef std::chrono::steady_clock Clock;
+    double best = std::numeric_limits<double>::infinity();
+    for (int trial = 0; trial < 3; ++trial) {
+      Clock::duration elapsed(0);
+      size_t parses = 0;
+      while (elapsed < std::chrono::milliseconds(5)) {
+        Group flags;
+        Clock::time_point start = Clock::now();
+        bool success = flags.parseArgs(args.argc(), args.data());
+        elapsed += Clock::now() - start;
+        ++parses;
+        if (!success) {
+          ADD_FAILURE() << "Parse of " << args.tokens() << " tokens failed";
+          return best;
+        }
+      }
+      double seconds = std::chrono::duration<double>(elapsed).count();
+      best = std::min(best, seconds / parses / args.tokens());
+    }
+    return best;
+  }
+
+  /**
+   * Checks that parsing the inputs produced by `generate` into Group costs
+   * roughly the same per token at every size.
+   */
+  template<typename Group, typename Generator>
+  void expectLinear(Generator generate) {
+    double baseline = 0;
+    bool first = true;
+    for (size_t size : kSizes) {
+      ArgList args;
+      while (args.tokens() < size) {
+        generate(args, args.tokens());
+      }
+      double perToken = timePerToken<Group>(args);
+      if (first) {
+        baseline = perToken;
+        first = false;
+        continue;
+      }
+      EXPECT_LT(perToken, baseline * kAllowedSlowdown)
+          << "Parsing " << args.tokens() << " tokens cost " << perToken * 1e9
+          << "ns per token, versus " << baseline * 1e9 << "ns at "
+          << kSizes[0];
+    }
+  }
+
+  struct EntityFlags: Flags::FlagGroup {
+    Flags::Flag<int64_t> id = Flags::flag(this, "id");
+    Flags::Flag<string>  name = Flags::flag(this, "name");
+    Flags::Flag<double>  x = Flags::flag(this, "x", 'x');
+    Flags::Flag<double>  y = Flags::flag(this, "y", 'y');
+    EntityFlags(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct RepeatedGroups: Flags::FlagGroup {
+    Flags::Flag<vector<EntityFlags>> entities = Flags::flag(this, "entity");
+  };
+
+  TEST(ComplexityTest, RepeatedGroups) {
+    expectLinear<RepeatedGroups>([](ArgList &args, size_t i) {
+      args.add("--entity");
+      args.add("--id=" + std::to_string(i));
+      args.add("--name");
+      args.add("entity");
+      args.add("-x");
+      args.add("1.5");
+      args.add("-y");
+      args.add("2.5");
+    });
+  }
+
+  struct ValueRuns: Flags::FlagGroup {
+    Flags::Flag<vector<int>> inds = Flags::flag(this, "ind");
+  };
+
+  TEST(ComplexityTest, LongValueRuns) {
+    expectLinear<ValueRuns>([](ArgList &args, size_t i) {
+      if (!i) {
+        args.add("--ind");
+      }
+      args.add(std::to_string(i));
+    });
+  }
+
+  struct Level4: Flags::FlagGroup {
+    Flags::Flag<vector<int>> values = Flags::flag(this, "values", 'v');
+    Level4(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct Level3: Flags::FlagGroup {
+    Flags::Flag<vector<Level4>> children = Flags::flag(this, "l4");
+    Level3(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct Level2: Flags::FlagGroup {
+    Flags::Flag<vector<Level3>> children = Flags::flag(this, "l3");
+    Level2(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct Level1: Flags::FlagGroup {
+    Flags::Flag<vector<Level2>> children = Flags::flag(this, "l2");
+    Level1(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct DeepNesting: Flags::FlagGroup {
+    Flags::Flag<vector<Level1>> children = Flags::flag(this, "l1");
+    Flags::Flag<vector<int>> top = Flags::flag(this, "top");
+  };
+
+  TEST(ComplexityTest, DeepNesting) {
+    // Every iteration descends four scopes, then unwinds all of them.
+    expectLinear<DeepNesting>([](ArgList &args, size_t i) {
+      args.add("--l1");
+      args.add("--l2");
+      args.add("--l3");
+      args.add("--l4");
+      args.add("-v");
+      args.add(std::to_string(i));
+      args.add(std::to_string(i + 1));
+      args.add("--top");
+      args.add(std::to_string(i));
+    });
+  }
+
+  /// A group with Width members, each of which can be given repeatedly.
+  template<int Width> struct WideGroup: Flags::FlagGroup {
+    std::deque<Flags::Flag<vector<int>>> members;
+    WideGroup(CtorArgs args): FlagGroup(args) {
+      for (int i = 0; i < Width; ++i) {
+        members.emplace_back(Flags::flag(this, "w" + std::to_string(i)));
+      }
+    }
+  };
+
+  template<int Width> struct WideGroups: Flags::FlagGroup {
+    Flags::Flag<WideGroup<Width>> inner = Flags::flag(this, "inner");
+    Flags::Flag<vector<int>> top = Flags::flag(this, "top");
+  };
+
+  /**
+   * Returns the time per token for a parse which re-enters a group of Width
+   * members for every value, so that its parent consults it once per handful
+   * of tokens, naming each member in turn.
+   */
+  template<int Width> double wideTimePerToken() {
+    ArgList args;
+    for (size_t i = 0; args.tokens() < kSizes[1]; ++i) {
+      args.add("--inner");
+      args.add("--w" + std::to_string(i % Width));
+      args.add(std::to_string(i));
+      args.add("--top");
+      args.add(std::to_string(i));
+    }
+    return timePerToken<WideGroups<Width>>(args);
+  }
+
+  TEST(ComplexityTest, WideGroups) {
+    // The same number of tokens, spread over groups 8 and 64 times wider. A
+    // scan of the members for each name would cost as much more per token.
+    double baseline = wideTimePerToken<16>();
+    double wider = wideTimePerToken<128>();
+    double widest = wideTimePerToken<1024>();
+    EXPECT_LT(wider, baseline * kAllowedSlowdown)
+        << "128 members cost " << wider * 1e9 << "ns per token, versus "
+        << baseline * 1e9 << "ns with 16";
+    EXPECT_LT(widest, baseline * kAllowedSlowdown)
+        << "1024 members cost " << widest * 1e9 << "ns per token, versus "
+        << baseline * 1e9 << "ns with 16";
+  }
+}
@@ -21,16 +21,94 @@
 #define FLAGS_h
 
 #include <map>
-#include <queue>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include <memory>
+#include <array>
+#include <bitset>
+#include <tuple>
+#include <optional>
+#include <variant>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <charconv>
 #include <iterator>
+#include <istream>
+#include <ostream>
+#include <functional>
+#include <utility>
 #include <initializer_list>
 #include <type_traits>
 #include <limits>
 #include <cctype>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifndef DEEPFLAGS_NO_THREADS
+#  include <thread>
+#  include <mutex>
+#  include <condition_variable>
+#  include <system_error>
+#endif
+#ifndef DEEPFLAGS_NO_REGEX
+#  include <regex>
+#  include <memory>
+#endif
+#ifdef DEEPFLAGS_PARALLEL_STL
+#  include <execution>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && !defined(DEEPFLAGS_NO_SIMD)
+#  include <immintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#  include <unistd.h>
+#  include <cerrno>
+#  include <fcntl.h>
+#  include <sys/stat.h>
+#endif
+#if defined(__linux__) && !defined(DEEPFLAGS_NO_IO_URING) \
+    && defined(__has_include)
+#  if __has_include(<linux/io_uring.h>) && __has_include(<linux/version.h>) \
+      && __has_include(<sys/syscall.h>)
+#    include <linux/version.h>
+// IORING_OP_STATX first appears in the 5.6 headers.
+#    if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 6, 0)
+#      include <linux/io_uring.h>
+#      include <sched.h>
+#      include <sys/mman.h>
+#      include <sys/syscall.h>
+#      if defined(__NR_io_uring_setup) && defined(__NR_io_uring_enter)
+#        define DEEPFLAGS_IO_URING 1
+#      endif
+#    endif
+#  endif
+#endif
+#if !defined(DEEPFLAGS_NO_INCREMENTAL) && defined(__has_include)
+#  if __has_include(<ucontext.h>) && !defined(__APPLE__)
+#    include <ucontext.h>
+#    include <sys/mman.h>
+#    include <deque>
+#    include <exception>
+#    include <memory>
+#    define DEEPFLAGS_INCREMENTAL 1
+#  endif
+#endif
+
+/// The shortest run of values whose conversion is split across threads.
+#ifndef DEEPFLAGS_PARALLEL_MIN_VALUES
+#  define DEEPFLAGS_PARALLEL_MIN_VALUES 16384
+#endif
+
+/// The most threads running the checks given to checkAsync() in one parse.
+#ifndef DEEPFLAGS_CHECK_THREADS
+#  define DEEPFLAGS_CHECK_THREADS 8
+#endif
 
 namespace Flags {
   class FlagGroup;
@@ -41,14 +119,17 @@ namespace Flags {
     const std::string valueName;
     const bool greedy;
     const bool reentrant;
+    const char delimiter;
    
    public:
     FlagProperties(std::string flagNameOrEmpty, char shortNameOrZero,
-        std::string valueNameOrEmpty, bool isGreedy, bool isReentrant):
+        std::string valueNameOrEmpty, bool isGreedy, bool isReentrant,
+        char delimiterOrZero = 0):
             flagName(flagNameOrEmpty), shortName(shortNameOrZero),
             valueName(valueNameOrEmpty),
             greedy(isGreedy),
-            reentrant(isReentrant) {}
+            reentrant(isReentrant),
+            delimiter(delimiterOrZero) {}
     
     bool hasShortName() const { return shortName; }
     bool hasLongName()  const { return flagName.length(); }
@@ -62,6 +143,8 @@ namespace Flags {
     
     bool isRepeatable() const { return reentrant; }
     bool acceptsMultipleValues() const { return greedy; }
+    bool splitsValues() const { return delimiter; }
+    char getDelimiter() const { return delimiter; }
     
     std::string listFlagNames() const {
       if (hasLongName()) {
@@ -128,13 +211,13 @@ namespace Flags {
       const size_t workingSpace = consoleWidth - indent;
       for (size_t i = 0, lineStart = i; i < tlen; ) {
         const size_t indentStart = i;
-        while (isspace(text[i]) && ++i < tlen);
+        while (isspace((unsigned char) text[i]) && ++i < tlen);
         if (i >= tlen) {
           break;
         }
         
         const size_t wordStart = i;
-        while (!isspace(text[++i]) && i < tlen);
+        while (++i < tlen && !isspace((unsigned char) text[i]));
         const size_t wlen = i - wordStart;
         
         if (i - lineStart > workingSpace) {
@@ -156,7 +239,7 @@ namespace Flags {
         consoleWidth(getConsoleWidth()), stream(ostream), indent(0) {}
     
     void enterFlag(FlagProperties props) override {
-      if (props.hasAnyName()) {
+      if (props.hasAnyName() || props.hasValueName()) {
         writeIndentation();
         stream << "\x1B[1m";
         writeFlagHeader(stream, props);
@@ -194,6 +277,10 @@ namespace Flags {
         }
         
         sstream << props.getValueName();
+        if (props.splitsValues()) {
+          sstream << "[" << props.getDelimiter() << props.getValueName()
+                  << "...]";
+        }
         if (greedy) {
           sstream << " [" << props.getValueName()
                  << " [" << props.getValueName() << "...]]";
@@ -231,10 +318,189 @@ namespace Flags {
     ~BasicHelpPrinter() override {}
   };
   
+  /**
+   * A view of consecutive arguments within an argv array, such as those left
+   * over after "--". Nothing is copied; the view is valid for as long as the
+   * array it points into.
+   */
+  class ArgSpan {
+    const char *const *first = nullptr;
+    size_t count = 0;
+    
+   public:
+    ArgSpan() {}
+    ArgSpan(const char *const *args, size_t size): first(args), count(size) {}
+    
+    const char *const *data() const { return first; }
+    const char *const *begin() const { return first; }
+    const char *const *end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return !count; }
+    const char *operator[](size_t i) const { return first[i]; }
+  };
+  
+  /**
+   * A run of consecutive arguments, by index into argv. Indices, unlike
+   * pointers, stay valid while arguments are still arriving.
+   */
+  struct ArgRange {
+    unsigned first = 0;
+    unsigned count = 0;
+  };
+  
+  /**
+   * A path to a file or directory, as given. Flags of this type can require
+   * that each path exists, or can be read, with mustExist() and
+   * mustBeReadable(); the paths are then checked together once parsing ends.
+   */
+  class Path {
+    std::string text;
+    
+   public:
+    Path() {}
+    explicit Path(std::string_view path): text(path) {}
+    
+    const std::string &str() const { return text; }
+    const char *c_str() const { return text.c_str(); }
+    operator std::string_view() const { return text; }
+    bool empty() const { return text.empty(); }
+    
+    bool operator==(const Path &o) const { return text == o.text; }
+    bool operator!=(const Path &o) const { return text != o.text; }
+    bool operator<(const Path &o) const { return text < o.text; }
+  };
+  
+  /// What a map flag does when given the same key more than once.
+  enum class DuplicateKeys {
+    kLastWins,   ///< The value given last replaces any before it.
+    kFirstWins,  ///< The value given first is kept; later ones are ignored.
+    kError,      ///< Giving a key twice is an error.
+  };
+  
+  /// One name by which an enumerator can be given on the command line.
+  template<typename E> struct EnumName {
+    std::string_view name;
+    E value;
+  };
+  
+  /**
+   * Names the values of an enum, so that it can be used as a flag. Specialize
+   * this with a constexpr array of names, for example:
+   * 
+   *     template<> struct Flags::EnumNames<Color> {
+   *       static constexpr Flags::EnumName<Color> values[] = {
+   *         { "red", Color::kRed }, { "green", Color::kGreen },
+   *       };
+   *     };
+   */
+  template<typename E> struct EnumNames;
+  
   namespace Internal {
     using std::map;
     using std::string;
-    using std::queue;
+    using std::string_view;
+    
+    /// Spells out a value given to a builder method, for parsing later.
+    template<typename T> string formatValue(const T &value) {
+      if constexpr (std::is_same<T, bool>::value) {
+        return value ? "true" : "false";
+      } else if constexpr (std::is_arithmetic<T>::value) {
+        char buf[64];
+        auto res = std::to_chars(buf, buf + sizeof(buf), value);
+        return string(buf, res.ptr);
+      } else {
+        return string(value);
+      }
+    }
+    
+    /// The checks mustExist() and mustBeReadable() ask for, as bits.
+    enum PathCheck : unsigned {
+      kPathExists = 1,
+      kPathReadable = 2,
+    };
+    
+    /// Restrictions on values, as stored in a Declaration, tagged by type.
+    struct DeclaredRules {
+      const void *type;
+    };
+    
+    /**
+     * A set of member indices, one bit each. The first sixty-four are stored
+     * inline, so that most groups need no allocation for them.
+     */
+    class MemberBits {
+      uint64_t low = 0;
+      std::vector<uint64_t> high;
+      
+     public:
+      size_t words() const {
+        return high.size() + 1;
+      }
+      
+      uint64_t word(size_t w) const {
+        return !w ? low : w <= high.size() ? high[w - 1] : 0;
+      }
+      
+      bool test(size_t index) const {
+        return word(index / 64) >> index % 64 & 1;
+      }
+      
+      void set(size_t index) {
+        const uint64_t bit = uint64_t(1) << index % 64;
+        if (index < 64) {
+          low |= bit;
+          return;
+        }
+        if (index / 64 > high.size()) {
+          high.resize(index / 64);
+        }
+        high[index / 64 - 1] |= bit;
+      }
+      
+      void clear() {
+        low = 0;
+        std::fill(high.begin(), high.end(), 0);
+      }
+    };
+    
+    enum class ConstraintKind {
+      /// At most one of the flags may be given.
+      kExclusive,
+      /// At least one of the flags must be given.
+      kAnyOf,
+      /// If the subject is given, all of the flags must be given as well.
+      kDependency,
+    };
+    
+    /// A rule over member presence, compiled into a mask of presence bits.
+    struct Constraint {
+      ConstraintKind kind;
+      size_t subject;
+      MemberBits flags;
+    };
+    
+    /**
+     * What is built once for a flag's declaration and shared by each instance
+     * of it, such as the same member of every element of a repeated group. A
+     * group's record holds one for each member, in the order they are added.
+     */
+    struct Declaration {
+      std::shared_ptr<const DeclaredRules> rules;
+      std::vector<std::shared_ptr<Declaration>> members;
+      std::vector<Constraint> constraints;
+      
+      /// Set once the declaration is found to be invalid.
+      bool misdeclared = false;
+    };
+    
+    /// The builder methods which only some kinds of flag support, as bits.
+    enum FlagOption : unsigned {
+      kSplitOn = 1,
+      kRestrict = 2,
+      kMatches = 4,
+      kCheckAsync = 8,
+      kPathChecks = 16,
+    };
     
     struct CtorArgs {
       FlagGroup *_group;
@@ -244,6 +510,19 @@ namespace Flags {
       string _description;
       string _valuename;
       bool _required = false;
+      bool _positional = false;
+      char _delimiter = 0;
+      DuplicateKeys _duplicates = DuplicateKeys::kLastWins;
+      
+      bool _bounded = false;
+      string _min, _max;
+      std::vector<string> _allowed;
+      string _pattern;
+      std::shared_ptr<const std::function<string(string_view)>> _checkAsync;
+      unsigned _pathChecks = 0;
+      
+      /// The record of this declaration, if not that of its group's member.
+      std::shared_ptr<Declaration> _declaration;
       
       CtorArgs(FlagGroup *group, string longName):
           _group(group), _longName(longName), _shortName(0) {}
@@ -273,849 +552,5107 @@ namespace Flags {
         return *this;
       }
       
-      // ---------------------------------------------------------------
-          
-      CtorArgs():
-          _group(nullptr), _longName(), _shortName(0) {}
-    };
-    
-    class ArgReader {
-      const unsigned argc;
-      const char *const *const argv;
-      
-      char charKey;
-      std::string key;
-      std::string value;
-      
-      bool flagAbsent = true;
-      bool flagIsCharacter = false;
-      bool valueSpecified = false;
-      bool clearedOut = false;
-      unsigned position = 0;
-      
-      std::queue<char> charFlags;
-      
-     public:
-      bool atEnd() const {
-        return clearedOut;
+      /**
+       * Splits each value given to a list flag on the given character, so
+       * that `--ind=1,2,3` yields three elements. Applies only to lists of
+       * plain values, such as `Flag<vector<int>>`.
+       */
+      CtorArgs &splitOn(char delimiter) {
+        _delimiter = delimiter;
+        return *this;
       }
       
-      bool hasMoreArguments() const {
-        return position < argc;
+      /// Chooses how a map flag treats a key given more than once.
+      CtorArgs &onDuplicateKey(DuplicateKeys policy) {
+        _duplicates = policy;
+        return *this;
       }
       
-      void parseNextArg() {
-        flagAbsent = false;
-        valueSpecified = false;
-        flagIsCharacter = false;
-        value.clear();
-        charKey = 0;
-        
-        if (charFlags.size()) {
-          flagIsCharacter = true;
-          charKey = charFlags.front();
-          charFlags.pop();
-          return;
-        }
-        
-        if (position >= argc || ++position >= argc) {
-          key.clear();
-          clearedOut = true;
-          return;
-        }
-        
-        const char *curArg = argv[position];
-        if (*curArg != '-') {
-          key.clear();
-          value = curArg;
-          flagAbsent = true;
-          valueSpecified = true;
-          return;
-        }
-        if (curArg[1] == '-') {
-          for (size_t i = 2; curArg[i]; ++i) {
-            if (curArg[i] == '=') {
-              key = string(curArg + 2, curArg + i);
-              value = string(curArg + i + 1);
-              valueSpecified = true;
-              return;
-            }
-          }
-          key = curArg + 2;
-          return;
-        }
-        
-        flagIsCharacter = true;
-        key.clear();
-        charKey = curArg[1];
-        for (size_t i = 2; curArg[i]; ++i) {
-          charFlags.push(curArg[i]);
-        }
+      /// Accepts only values between the given bounds, inclusive.
+      template<typename T> CtorArgs &range(T min, T max) {
+        _bounded = true;
+        _min = formatValue(min);
+        _max = formatValue(max);
+        return *this;
       }
       
-      /** Extract and return the next argument as a raw value. */
-      string nextRawArgument() {
-        flagAbsent = true;
-        valueSpecified = true;
-        flagIsCharacter = false;
-        key.clear();
-        return value = argv[++position];
+      /// Accepts only the given values.
+      template<typename T> CtorArgs &oneOf(std::initializer_list<T> values) {
+        for (const T &value : values) {
+          _allowed.push_back(formatValue(value));
+        }
+        return *this;
       }
       
-      bool hasValue() const {
-        return valueSpecified;
+#   ifndef DEEPFLAGS_NO_REGEX
+      /// Accepts only values whose text matches the given ECMAScript regex.
+      CtorArgs &matches(string pattern) {
+        _pattern = pattern;
+        return *this;
       }
+#   endif
       
-      string getValue() const {
-        return value;
+      /**
+       * Checks each value with the given function on a worker thread, started
+       * as soon as the value is accepted, while parsing continues. The
+       * function returns an empty string to accept the value, or else why it
+       * is rejected; it must be safe to call from several threads at once.
+       * Failures are reported together before parseArgs() returns.
+       */
+      CtorArgs &checkAsync(std::function<string(string_view)> check) {
+        _checkAsync = std::make_shared<const std::function<
+            string(string_view)>>(std::move(check));
+        return *this;
       }
       
-      bool hasAnyFlag() const {
-        return !flagAbsent;
+      /**
+       * Accepts only paths which name an existing file or directory. Applies
+       * only to flags whose values are Paths; any other flag given it fails
+       * every parse.
+       */
+      CtorArgs &mustExist() {
+        _pathChecks |= kPathExists;
+        return *this;
       }
       
-      bool hasLongFlag() const {
-        return !flagAbsent && !flagIsCharacter;
+      /// Accepts only paths which exist and which can be read, as mustExist().
+      CtorArgs &mustBeReadable() {
+        _pathChecks |= kPathExists | kPathReadable;
+        return *this;
       }
       
-      bool hasShortFlag() const {
-        return !flagAbsent && flagIsCharacter;
-      }
+      // ---------------------------------------------------------------
       
-      string getLongFlag() const {
-        return key;
+      /// Returns which of the builder methods in FlagOption were called.
+      unsigned options() const {
+        unsigned options = 0;
+        if (_delimiter) {
+          options |= kSplitOn;
+        }
+        if (_bounded || !_allowed.empty()) {
+          options |= kRestrict;
+        }
+        if (!_pattern.empty()) {
+          options |= kMatches;
+        }
+        if (_checkAsync) {
+          options |= kCheckAsync;
+        }
+        if (_pathChecks) {
+          options |= kPathChecks;
+        }
+        return options;
       }
       
-      char getShortFlag() const {
-        return charKey;
+      /// Forgets the builder methods in FlagOption, once they are handled.
+      void dropOptions() {
+        _delimiter = 0;
+        _bounded = false;
+        _allowed.clear();
+        _pattern.clear();
+        _checkAsync = nullptr;
+        _pathChecks = 0;
       }
+          
+      CtorArgs():
+          _group(nullptr), _longName(), _shortName(0) {}
+    };
+    
+    /**
+     * Keeps one copy of each distinct string given to it, so that equal
+     * strings are stored once and share an address.
+     */
+    class InternTable {
+      std::deque<string> strings;
+      std::unordered_set<string_view> index;
       
-      string quotedFlagName() const {
-        if (hasLongFlag()) {
-          return "\"" + getLongFlag() + "\"";
-        }
-        if (hasShortFlag()) {
-          char res[4] = "'?'";
-          res[1] = getShortFlag();
-          return res;
+     public:
+      /// Returns the stored copy of the given text, storing it if it is new.
+      string_view intern(string_view text) {
+        auto found = index.find(text);
+        if (found != index.end()) {
+          return *found;
         }
-        return "<Unspecified>";
+        strings.emplace_back(text);
+        return *index.insert(strings.back()).first;
       }
       
-      unsigned tell() const {
-        return position;
+      size_t size() const {
+        return strings.size();
       }
-      
-      ArgReader(int _argc, const char *const *const _argv):
-          argc(_argc < 0 ? 0 : _argc), argv(_argv) {}
     };
     
-    class FlagBase {
-      const string _name;
-      const char _shortname;
-      bool _required = false;
-      
-      const string _description;
-      const string _valuename;
+    /**
+     * Runs the checks given to checkAsync() on up to DEEPFLAGS_CHECK_THREADS
+     * worker threads, which are started as checks arrive, and collects their
+     * failures until finish() is called.
+     */
+    class CheckPool {
+     public:
+      typedef std::function<string(string_view)> Check;
       
-      inline void addThisTo(FlagGroup *group);
-    
-     protected:
-      typedef Internal::CtorArgs CtorArgs;
+     private:
+      struct Task {
+        size_t sequence;
+        std::shared_ptr<const Check> check;
+        string value;
+        string flag;
+        size_t number;
+      };
       
-      /// Circumvents the fact that protected members can only be called on
-      /// pointers to the caller class.
-      static inline bool invokeParse(FlagBase *flag, ArgReader &argReader) {
-        return flag->parseArgsR(argReader);
-      }
+      struct Failure {
+        size_t sequence;
+        string message;
+      };
       
-      /// Circumvents the fact that protected members can only be called on
-      /// pointers to the caller class.
-      static bool pHasFlag(const FlagBase &fb, string flag) {
-        return fb.hasFlag(flag);
-      }
+      size_t submitted = 0;
+      std::vector<Failure> failures;
       
-      /// Circumvents the fact that protected members can only be called on
-      /// pointers to the caller class.
-      static bool pHasFlag(const FlagBase &fb, char flag) {
-        return fb.hasFlag(flag);
+      /// Runs the given task, returning why its value was rejected, if it was.
+      static string run(const Task &task) {
+        try {
+          return (*task.check)(task.value);
+        } catch (const std::exception &e) {
+          return e.what();
+        } catch (...) {
+          return "check failed with an unknown exception";
+        }
       }
       
-      /// Circumvents the fact that protected members can only be called on
-      /// pointers to the caller class.
-      static bool pAtCapacity(const FlagBase &fb) {
-        return fb.atCapacity();
+      static string describe(const Task &task, const string &reason) {
+        char position[32] = "";
+        if (task.number) {
+          snprintf(position, sizeof(position), " (value #%zu)", task.number);
+        }
+        return "Invalid value \"" + task.value + "\" for flag " + task.flag
+            + position + ": " + reason;
       }
       
-      /**
-       * Parses as many values as possible from the given stream.
-       * @return true on success, false if an error occurred
-       * @note this function can return success even if no input is parsed
-       */
-      virtual bool parseArgsR(ArgReader& argReader) = 0;
+#   ifndef DEEPFLAGS_NO_THREADS
+      std::mutex mutex;
+      std::condition_variable wake;
+      std::deque<Task> queue;
+      std::vector<std::thread> workers;
+      unsigned idle = 0;
+      bool closing = false;
       
-      /** Returns false iff this flag can receieve an additional value. */
-      virtual bool atCapacity() const = 0;
+      void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        for (;;) {
+          if (queue.empty()) {
+            if (closing) {
+              return;
+            }
+            ++idle;
+            wake.wait(lock);
+            --idle;
+            continue;
+          }
+          Task task = std::move(queue.front());
+          queue.pop_front();
+          lock.unlock();
+          string reason = run(task);
+          lock.lock();
+          if (!reason.empty()) {
+            failures.push_back({ task.sequence, describe(task, reason) });
+          }
+        }
+      }
       
-      /**
-       * Returns true if this flag has anything to do with the given flag name,
-       * or false otherwise.
-       */
-      virtual bool hasFlag(string name) const = 0;
+      /// Waits for every task to finish, and stops the workers.
+      void join() {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          closing = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers) {
+          worker.join();
+        }
+        workers.clear();
+        closing = false;
+      }
+#   endif
       
+     public:
       /**
-       * Returns true if this flag has anything to do with the given flag name,
-       * or false otherwise.
+       * Starts checking the given value, which is copied. Values in a list are
+       * numbered from one; zero means the value stands alone.
        */
-      virtual bool hasFlag(char name) const = 0;
+      void submit(std::shared_ptr<const Check> check, string_view value,
+                  const string &flag, size_t number) {
+        Task task { submitted++, std::move(check), string(value), flag,
+                    number };
+#     ifndef DEEPFLAGS_NO_THREADS
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!idle && workers.size() < DEEPFLAGS_CHECK_THREADS) {
+          try {
+            workers.emplace_back(&CheckPool::work, this);
+          } catch (const std::system_error&) {}
+        }
+        // If no thread could be started, the check runs on this one.
+        if (!workers.empty()) {
+          queue.push_back(std::move(task));
+          lock.unlock();
+          wake.notify_one();
+          return;
+        }
+        lock.unlock();
+#     endif
+        string reason = run(task);
+        if (!reason.empty()) {
+          failures.push_back({ task.sequence, describe(task, reason) });
+        }
+      }
       
       /**
-       * Print help text for this flag to the given stream. Prefix the given
-       * indentation.
+       * Waits for every check started, then prints each failure, in the order
+       * the values were given.
+       * @return true if every value was accepted
        */
-      virtual void printHelp(HelpPrinter &printer) const {
-        printer.enterFlag(makeProps());
-        if (hasDescription()) {
-          printer.writeBlock(getDescription());
+      bool finish() {
+#     ifndef DEEPFLAGS_NO_THREADS
+        join();
+#     endif
+        std::sort(failures.begin(), failures.end(),
+            [](const Failure &a, const Failure &b) {
+              return a.sequence < b.sequence;
+            });
+        for (const Failure &failure : failures) {
+          fprintf(stderr, "%s\n", failure.message.c_str());
         }
-        printer.leaveFlag();
+        const bool accepted = failures.empty();
+        failures.clear();
+        submitted = 0;
+        return accepted;
       }
       
-      FlagProperties makeProps(
-          bool greedy = false, bool reentrant = false) const {
-        return FlagProperties(_name, _shortname, _valuename, greedy, reentrant);
+      ~CheckPool() {
+#     ifndef DEEPFLAGS_NO_THREADS
+        join();
+#     endif
       }
+    };
+    
+#   if defined(__unix__) || defined(__APPLE__)
+    /// The effective user and groups of this process, for permission checks.
+    struct Credentials {
+      uid_t uid = geteuid();
+      gid_t gid = getegid();
+      std::vector<gid_t> groups;
       
-      static void printHelpR(const FlagBase *flag, HelpPrinter &printer) {
-        flag->printHelp(printer);
+      Credentials() {
+        int count = getgroups(0, nullptr);
+        if (count > 0) {
+          groups.resize(count);
+          count = getgroups(count, groups.data());
+          groups.resize(count > 0 ? count : 0);
+        }
       }
       
       /**
-       * Perform the neccessary steps to ensure the contents of this flag will
-       * be parsed if the flags are present. Normally this is the same as a call
-       * to `addThisTo()`. An example of where this is not the case would be an
-       * anonymous flag group, which adds its contents to the given group.
+       * Returns whether permission bits with the given owner allow reading.
+       * Access control lists are not consulted.
        */
-      virtual bool addSelfTo(FlagGroup *group) {
-        addThisTo(group);
-        return true;
+      bool canRead(uint32_t owner, uint32_t group, unsigned mode) const {
+        if (uid == 0) {
+          return true;
+        }
+        if (owner == uid) {
+          return mode & S_IRUSR;
+        }
+        if (group == gid
+            || std::find(groups.begin(), groups.end(), group) != groups.end()) {
+          return mode & S_IRGRP;
+        }
+        return mode & S_IROTH;
       }
+    };
+#   endif
+    
+#   ifdef DEEPFLAGS_IO_URING
+    /**
+     * The kernel's struct statx, up to the fields read here. It is declared
+     * rather than included, as <linux/stat.h> conflicts with <sys/stat.h>.
+     */
+    struct StatxBuffer {
+      uint32_t mask;
+      uint32_t blksize;
+      uint64_t attributes;
+      uint32_t nlink;
+      uint32_t uid;
+      uint32_t gid;
+      uint16_t mode;
+      uint8_t rest[226];
+    };
+    static_assert(sizeof(StatxBuffer) == 256, "struct statx is 256 bytes");
+    
+    /**
+     * A minimal io_uring, set up with raw system calls, which runs a batch of
+     * statx calls in as few as one system call.
+     */
+    class StatxRing {
+      /// STATX_TYPE, STATX_MODE, STATX_UID and STATX_GID.
+      static constexpr unsigned kWanted = 0x1 | 0x2 | 0x8 | 0x10;
       
-      class Instantiator {
-       public:
-        template<class T> static T instantiate(CtorArgs args) {
-          return T(args);
-        }
-      };
+      int fd = -1;
+      unsigned capacity = 0;
+      void *rings = MAP_FAILED;
+      size_t ringsSize = 0;
+      void *sqeMap = MAP_FAILED;
+      size_t sqeMapSize = 0;
       
-      CtorArgs getCtorArgs(FlagGroup *group) const {
-        return CtorArgs(group, _name, _shortname);
-      }
+      unsigned *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+      unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+      io_uring_cqe *cqes = nullptr;
       
-      FlagBase(CtorArgs construct):
-          _name(construct._longName), _shortname(construct._shortName),
-          _description(construct._description),
-          _valuename(construct._valuename) {
-        if (construct._group) {
-          addThisTo(construct._group);
+      void release() {
+        if (sqeMap != MAP_FAILED) {
+          munmap(sqeMap, sqeMapSize);
+        }
+        if (rings != MAP_FAILED) {
+          munmap(rings, ringsSize);
+        }
+        if (fd >= 0) {
+          close(fd);
         }
+        fd = -1;
+        rings = sqeMap = MAP_FAILED;
       }
       
-     public:
-
-      bool hasShortName() const {
-        return _shortname;
-      }
-
-      char getShortName() const {
-        return _shortname;
-      }
-
-      bool hasLongName() const {
-        return _name.length();
+      /// Stores the result of each completed call, returning how many.
+      unsigned reap(int *results) {
+        unsigned head = *cqHead;
+        const unsigned done = __atomic_load_n(cqTail, __ATOMIC_ACQUIRE);
+        unsigned reaped = 0;
+        for (; head != done; ++head, ++reaped) {
+          const io_uring_cqe &cqe = cqes[head & *cqMask];
+          results[cqe.user_data] = cqe.res;
+        }
+        __atomic_store_n(cqHead, head, __ATOMIC_RELEASE);
+        return reaped;
       }
-
-      string getLongName() const {
-        return _name;
+      
+      /**
+       * Waits for every call submitted to complete, as each still writes to
+       * its buffer. Completions are posted whether or not they are waited
+       * for, so should waiting fail, this polls for them instead.
+       */
+      void drain(int *results, unsigned completed, unsigned submitted) {
+        while (completed < submitted) {
+          if (syscall(__NR_io_uring_enter, fd, 0, 1, IORING_ENTER_GETEVENTS,
+                      nullptr, 0) < 0 && errno != EINTR) {
+            sched_yield();
+          }
+          completed += reap(results);
+        }
       }
-
-      bool hasAnyName() const {
-        return _name.length() || _shortname;
+     
+     public:
+      explicit StatxRing(unsigned entries) {
+        io_uring_params params;
+        memset(&params, 0, sizeof(params));
+        fd = int(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd < 0) {
+          return;
+        }
+        // Kernels without a single mapping are too old for statx anyway.
+        if (!(params.features & IORING_FEAT_SINGLE_MMAP)) {
+          release();
+          return;
+        }
+        ringsSize = std::max(
+            params.sq_off.array + params.sq_entries * sizeof(unsigned),
+            params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+        rings = mmap(nullptr, ringsSize, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        sqeMapSize = params.sq_entries * sizeof(io_uring_sqe);
+        sqeMap = mmap(nullptr, sqeMapSize, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (rings == MAP_FAILED || sqeMap == MAP_FAILED) {
+          release();
+          return;
+        }
+        char *base = static_cast<char*>(rings);
+        sqTail = reinterpret_cast<unsigned*>(base + params.sq_off.tail);
+        sqMask = reinterpret_cast<unsigned*>(base + params.sq_off.ring_mask);
+        sqArray = reinterpret_cast<unsigned*>(base + params.sq_off.array);
+        cqHead = reinterpret_cast<unsigned*>(base + params.cq_off.head);
+        cqTail = reinterpret_cast<unsigned*>(base + params.cq_off.tail);
+        cqMask = reinterpret_cast<unsigned*>(base + params.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe*>(base + params.cq_off.cqes);
+        capacity = params.sq_entries;
       }
       
-      bool hasDescription() const {
-        return _description.length();
-      }
+      StatxRing(const StatxRing&) = delete;
+      StatxRing &operator=(const StatxRing&) = delete;
       
-      string getDescription() const {
-        return _description;
+      ~StatxRing() {
+        release();
       }
       
-      bool hasValueName() const {
-        return _valuename.length();
+      bool ready() const {
+        return fd >= 0;
       }
       
-      string getValueName() const {
-        return _valuename;
+      /// Returns the most calls which can be run in one batch.
+      unsigned size() const {
+        return capacity;
       }
-
-      bool parseArgs(int argc, const char* const* const argv) {
-        if (argc < 2) {
-          return true; 
-        }
-        ArgReader argReader(argc, argv);
-        argReader.parseNextArg();
-        if (!parseArgsR(argReader)) {
-          return false;
+      
+      /**
+       * Runs statx on each of up to size() paths, storing zero or a negated
+       * errno as the matching result. Returns only once no call is left
+       * writing to the buffers, even if the ring fails.
+       * @return false if the ring failed, and the results are incomplete
+       */
+      bool run(const char *const *paths, StatxBuffer *buffers, int *results,
+               unsigned count) {
+        io_uring_sqe *sqes = static_cast<io_uring_sqe*>(sqeMap);
+        unsigned tail = *sqTail;
+        for (unsigned i = 0; i < count; ++i, ++tail) {
+          const unsigned index = tail & *sqMask;
+          io_uring_sqe &sqe = sqes[index];
+          memset(&sqe, 0, sizeof(sqe));
+          sqe.opcode = IORING_OP_STATX;
+          sqe.fd = AT_FDCWD;
+          sqe.addr = uint64_t(uintptr_t(paths[i]));
+          sqe.len = kWanted;
+          sqe.off = uint64_t(uintptr_t(&buffers[i]));
+          sqe.user_data = i;
+          sqArray[index] = index;
         }
-        if (!argReader.atEnd()) {
-          if (argReader.hasLongFlag()) {
-            fprintf(stderr, "Unexpected flag \"%s\"\n",
-                argReader.getLongFlag().c_str());
-          } else if (argReader.hasShortFlag()) {
-            fprintf(stderr, "Unexpected flag '%c'\n",
-                argReader.getShortFlag());
-          } else if (argReader.hasValue()) {
-            fprintf(stderr, "Expected flag name, but got \"%s\"\n",
-                argReader.getValue().c_str());
-          } else {
-            fputs("Internal error: "
-                "Not all arguments were read and argument reader is not sane.",
-                stderr);
+        __atomic_store_n(sqTail, tail, __ATOMIC_RELEASE);
+        
+        unsigned submitted = 0, completed = 0;
+        while (completed < count) {
+          const long entered = syscall(__NR_io_uring_enter, fd,
+              count - submitted, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+          if (entered < 0) {
+            if (errno == EINTR) {
+              continue;
+            }
+            drain(results, completed, submitted);
+            return false;
           }
-          return false;
+          submitted += unsigned(entered);
+          completed += reap(results);
         }
         return true;
       }
-
-      virtual ~FlagBase() {}
     };
+#   endif
     
-    static inline map<string, bool> _boolNames() {
-      map<string, bool> res;
-      res["1"] = true;
-      res["on"] = true;
-      res["yes"] = true;
-      res["true"] = true;
-      res["0"] = false;
-      res["no"] = false;
-      res["off"] = false;
-      res["false"] = false;
-      return res;
-    }
-    
-    static map<string, bool> boolNames = _boolNames();
-    
-    static string lower(string x) {
-      for (size_t i = 0; i < x.length(); ++i) {
-        x[i] = std::tolower(x[i]);
+    /**
+     * Collects the paths given to flags declared with mustExist() or
+     * mustBeReadable(), then checks them all together once parsing ends: in
+     * batches through io_uring where the kernel allows it, and otherwise with
+     * stat() from several threads. Failures are reported in one diagnostic.
+     */
+    class PathChecks {
+      struct Entry {
+        size_t offset;
+        size_t number;
+        unsigned flag;
+        unsigned checks;
+        int error;
+        bool readable;
+      };
+      
+      /// The paths, each followed by a NUL.
+      string chars;
+      std::vector<Entry> entries;
+      /// The names of the flags given the paths, for errors.
+      std::vector<string> flags;
+      
+      /// The fewest paths worth starting a thread to check.
+      static constexpr size_t kPathsPerThread = 256;
+      
+      const char *path(const Entry &entry) const {
+        return chars.data() + entry.offset;
       }
-      return x;
-    }
-    
-    template<typename T> class ParseType;
-    
-    template<> struct ParseType<bool> {
-      bool error = false;
-      bool value = false;
-      ParseType(string val) {
-        auto valit = Internal::boolNames.find(Internal::lower(val));
-        if (valit == Internal::boolNames.end()) {
-          error = true;
-        } else {
-          value = valit->second;
+      
+#   if defined(__unix__) || defined(__APPLE__)
+      /// Fills in the given entries with stat().
+      void statRange(size_t begin, size_t end, const Credentials &user) {
+        for (size_t i = begin; i < end; ++i) {
+          Entry &entry = entries[i];
+          struct stat status;
+          if (stat(path(entry), &status)) {
+            entry.error = errno;
+          } else {
+            entry.readable = user.canRead(status.st_uid, status.st_gid,
+                                          status.st_mode);
+          }
         }
       }
-    };
-    
-    template<> struct ParseType<char> {
-      bool error = false;
-      char value = 0;
-      ParseType(string val) {
-        if (val.length() != 1) {
-          error = true;
-        } else {
-          value = val[0];
+#   else
+      /// Fills in the given entries by opening each path.
+      void statRange(size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          Entry &entry = entries[i];
+          if (FILE *file = fopen(path(entry), "rb")) {
+            fclose(file);
+            entry.readable = true;
+          } else {
+            entry.error = errno;
+          }
         }
       }
-    };
-    
-    template<typename T, typename BT, BT (*parse)(const string&, size_t*, int)>
-    struct ParseIntType {
-      bool error = false;
-      T value = 0;
-      ParseIntType(string val) {
-        try {
-          BT i = parse(val, nullptr, 0);
-          if (i >= std::numeric_limits<T>::min()
-              && i <= std::numeric_limits<T>::max()) {
-            value = i;
-            return;
+#   endif
+      
+#   ifdef DEEPFLAGS_IO_URING
+      /**
+       * Fills in every entry through io_uring.
+       * @return false if io_uring or its statx is unavailable
+       */
+      bool statxAll(const Credentials &user) {
+        StatxRing ring(256);
+        if (!ring.ready()) {
+          return false;
+        }
+        const unsigned batch = ring.size();
+        std::vector<const char*> paths(batch);
+        std::vector<StatxBuffer> buffers(batch);
+        std::vector<int> results(batch);
+        for (size_t first = 0; first < entries.size(); first += batch) {
+          const unsigned count = unsigned(
+              std::min<size_t>(batch, entries.size() - first));
+          for (unsigned i = 0; i < count; ++i) {
+            paths[i] = path(entries[first + i]);
           }
-        } catch (...) {}
-        error = true;
+          if (!ring.run(paths.data(), buffers.data(), results.data(),
+                        count)) {
+            return false;
+          }
+          for (unsigned i = 0; i < count; ++i) {
+            // Kernels before 5.6 do not know the statx operation.
+            if (results[i] == -EINVAL || results[i] == -EOPNOTSUPP) {
+              return false;
+            }
+            Entry &entry = entries[first + i];
+            if (results[i] < 0) {
+              entry.error = -results[i];
+            } else {
+              entry.readable = user.canRead(buffers[i].uid, buffers[i].gid,
+                                            buffers[i].mode);
+            }
+          }
+        }
+        return true;
       }
-    };
-    
-#   define df_internal_DEFINE_PRIM_PARSER(T, BT, IntParser) \
-    template<> struct ParseType<T>: ParseIntType<T, BT, IntParser> { \
-      ParseType(string val): ParseIntType(val) {} \
-    }
-    
-    df_internal_DEFINE_PRIM_PARSER(int8_t,  long long, std::stoll);
-    df_internal_DEFINE_PRIM_PARSER(int16_t, long long, std::stoll);
-    df_internal_DEFINE_PRIM_PARSER(int32_t, long long, std::stoll);
-    df_internal_DEFINE_PRIM_PARSER(int64_t, long long, std::stoll);
-    
-    df_internal_DEFINE_PRIM_PARSER(uint8_t,  unsigned long long, std::stoull);
-    df_internal_DEFINE_PRIM_PARSER(uint16_t, unsigned long long, std::stoull);
-    df_internal_DEFINE_PRIM_PARSER(uint32_t, unsigned long long, std::stoull);
-    df_internal_DEFINE_PRIM_PARSER(uint64_t, unsigned long long, std::stoull);
-    
-#   undef df_internal_DEFINE_PRIM_PARSER
-
-    template<typename T> struct ParseFloatType {
-      bool error = false;
-      T value = 0;
-      ParseFloatType(string val) {
-        try {
-          long double i = std::stold(val, nullptr);
-          if (i >= std::numeric_limits<T>::min()
-              && i <= std::numeric_limits<T>::max()) {
-            value = i;
+#   endif
+      
+      /**
+       * Returns whether this machine can check paths concurrently. With one
+       * processor, a batch costs more than it saves, at least while the
+       * paths are cached.
+       */
+      static bool concurrent() {
+#     ifndef DEEPFLAGS_NO_THREADS
+        return std::thread::hardware_concurrency() != 1;
+#     else
+        return true;
+#     endif
+      }
+      
+      /// Fills in every entry, by the fastest means available.
+      void statAll() {
+        const bool batched = concurrent();
+#     if defined(__unix__) || defined(__APPLE__)
+        const Credentials user;
+#       ifdef DEEPFLAGS_IO_URING
+          if (batched && statxAll(user)) {
             return;
           }
-        } catch (...) {}
-        error = true;
+          for (Entry &entry : entries) {
+            entry.error = 0;
+            entry.readable = false;
+          }
+#       endif
+        auto statChunk = [&](size_t begin, size_t end) {
+          statRange(begin, end, user);
+        };
+#     else
+        auto statChunk = [&](size_t begin, size_t end) {
+          statRange(begin, end);
+        };
+#     endif
+        const size_t count = entries.size();
+        const size_t chunks = !batched ? 1 : std::min<size_t>(
+            DEEPFLAGS_CHECK_THREADS, count / kPathsPerThread + 1);
+#     ifndef DEEPFLAGS_NO_THREADS
+        // If threads cannot be started, the remaining chunks are checked on
+        // this one.
+        std::vector<std::thread> threads;
+        try {
+          for (size_t i = 1; i < chunks; ++i) {
+            threads.emplace_back(statChunk, count * i / chunks,
+                                 count * (i + 1) / chunks);
+          }
+        } catch (const std::system_error&) {}
+        for (size_t i = threads.size() + 1; i < chunks; ++i) {
+          statChunk(count * i / chunks, count * (i + 1) / chunks);
+        }
+        statChunk(0, count / chunks);
+        for (std::thread &thread : threads) {
+          thread.join();
+        }
+#     else
+        (void) chunks;
+        statChunk(0, count);
+#     endif
       }
-    };
-    
-    template<> struct ParseType<float>: ParseFloatType<float> {
-      ParseType(string val): ParseFloatType(val) {}
-    };
-    
-    template<> struct ParseType<double>: ParseFloatType<double> {
-      ParseType(string val): ParseFloatType(val) {}
-    };
-    
-    template<> struct ParseType<long double>: ParseFloatType<long double> {
-      ParseType(string val): ParseFloatType(val) {}
-    };
-    
-    template<> struct ParseType<string> {
-      bool error = false;
-      string value;
-      ParseType(string val): value(val) {}
-    };
-    
-    class SingletonFlag: public FlagBase {
-     protected:
-      virtual bool parse(string rawvalue) = 0;
       
-      SingletonFlag(CtorArgs args): FlagBase(args) {}
+      /// Returns why the given entry fails its checks, or null if it passes.
+      static const char *failure(const Entry &entry) {
+        if (entry.error == ENOENT || entry.error == ENOTDIR) {
+          return "does not exist";
+        }
+        if (entry.error) {
+          return strerror(entry.error);
+        }
+        if ((entry.checks & kPathReadable) && !entry.readable) {
+          return "cannot be read";
+        }
+        return nullptr;
+      }
+     
+     public:
+      /**
+       * Queues the given path, which is copied, for the given checks. Values
+       * in a list are numbered from one; zero means the value stands alone.
+       */
+      void add(string_view path, const string &flag, size_t number,
+               unsigned checks) {
+        if (flags.empty() || flags.back() != flag) {
+          flags.push_back(flag);
+        }
+        entries.push_back({ chars.length(), number,
+                            unsigned(flags.size() - 1), checks, 0, false });
+        chars.append(path.data(), path.length());
+        chars.push_back('\0');
+      }
       
-      bool parseArgsR(ArgReader& argReader) final override {
-        if (argReader.hasValue()) {
-          if (!parse(argReader.getValue())) {
-            return false;
-          }
-          argReader.parseNextArg();
+      /**
+       * Checks every path queued, printing one diagnostic which lists each
+       * that failed.
+       * @return true if every path passed its checks
+       */
+      bool finish() {
+        if (entries.empty()) {
           return true;
-        } else if (argReader.hasMoreArguments()) {
-          if (!parse(argReader.nextRawArgument())) {
-            return false;
+        }
+        statAll();
+        size_t failed = 0;
+        for (const Entry &entry : entries) {
+          failed += failure(entry) != nullptr;
+        }
+        if (failed) {
+          fprintf(stderr, "%zu of %zu paths cannot be used:\n", failed,
+                  entries.size());
+          for (const Entry &entry : entries) {
+            if (const char *reason = failure(entry)) {
+              char position[32] = "";
+              if (entry.number) {
+                snprintf(position, sizeof(position), " (value #%zu)",
+                         entry.number);
+              }
+              fprintf(stderr, "  \"%s\" for flag %s%s %s\n", path(entry),
+                      flags[entry.flag].c_str(), position, reason);
+            }
           }
-          argReader.parseNextArg();
-          return true;
         }
-        return false;
+        chars.clear();
+        entries.clear();
+        flags.clear();
+        return !failed;
       }
     };
     
-    template<typename P> class PrimitiveFlag: public SingletonFlag {
+    /**
+     * Supplies arguments which were not yet available when parsing began. See
+     * IncrementalParser.
+     */
+    class ArgSource {
      public:
-      bool present = false;
-      P value = P();
+      /**
+       * Waits until the argument at the given index has arrived, or until the
+       * input has ended, then updates argc and argv to cover every argument
+       * received so far.
+       * @return true if the argument is now available, false at end of input
+       */
+      virtual bool await(unsigned index, unsigned &argc,
+                         const char *const *&argv) = 0;
       
-     protected:
-      PrimitiveFlag(CtorArgs args): SingletonFlag(args) {}
+      virtual ~ArgSource() {}
+    };
+    
+    class ArgReader {
+      unsigned argc;
+      const char *const *argv;
       
-      bool atCapacity() const override {
-        return present;
+      /// Asked for further arguments once argv runs out, unless null.
+      ArgSource *const source = nullptr;
+      
+      /// Strings interned while reading these arguments; created on demand.
+      std::shared_ptr<InternTable> interned;
+      
+      /// Checks started on values read from these arguments, if any.
+      std::unique_ptr<CheckPool> checks;
+      
+      /// Paths read from these arguments waiting to be checked, if any.
+      std::unique_ptr<PathChecks> paths;
+      
+      char charKey;
+      string_view key;
+      string_view value;
+      
+      bool flagAbsent = true;
+      bool flagIsCharacter = false;
+      bool valueSpecified = false;
+      bool clearedOut = false;
+      bool optionsEnded = false;
+      unsigned position = 0;
+      
+      /// The unread remainder of a chain of short flags, such as "-pb".
+      const char *charFlags = "";
+      
+      /// Returns whether the argument at the given index exists.
+      bool available(unsigned index) {
+        return index < argc || (source && source->await(index, argc, argv));
       }
       
-      bool hasFlag(string name) const override {
-        return getLongName() == name;
+     public:
+      bool atEnd() const {
+        return clearedOut;
       }
       
-      bool hasFlag(char name) const override {
-        return getShortName() == name;
+      /** Returns whether any argument follows the one currently read. */
+      bool hasMoreArguments() {
+        return !clearedOut && available(position + 1);
       }
       
-     public:
-      bool parse(string rawvalue) override {
-        ParseType<P> parsed(rawvalue);
-        if (parsed.error) {
-          return false;
+      void parseNextArg() {
+        flagAbsent = false;
+        valueSpecified = false;
+        flagIsCharacter = false;
+        value = string_view();
+        charKey = 0;
+        
+        if (*charFlags) {
+          flagIsCharacter = true;
+          charKey = *charFlags++;
+          return;
         }
-        value = parsed.value;
-        present = true;
-        return true;
-      }
-    };
-    
-    /// Wrapper to std::is_base_of to make other code bits more legible.
-    template<typename T> constexpr bool isFlag() {
+        
+        if (clearedOut || !available(++position)) {
+          key = string_view();
+          clearedOut = true;
+          return;
+        }
+        
+        const char *curArg = argv[position];
+        if (!optionsEnded && !strcmp(curArg, "--")) {
+          // Everything after "--" is a value, even if it looks like a flag.
+          optionsEnded = true;
+          if (!available(++position)) {
+            key = string_view();
+            clearedOut = true;
+            return;
+          }
+          curArg = argv[position];
+        }
+        if (optionsEnded || *curArg != '-' || !curArg[1]) {
+          key = string_view();
+          value = curArg;
+          flagAbsent = true;
+          valueSpecified = true;
+          return;
+        }
+        if (curArg[1] == '-') {
+          if (const char *eq = strchr(curArg + 2, '=')) {
+            key = string_view(curArg + 2, eq - curArg - 2);
+            value = eq + 1;
+            valueSpecified = true;
+            return;
+          }
+          key = curArg + 2;
+          return;
+        }
+        
+        flagIsCharacter = true;
+        key = string_view();
+        charKey = curArg[1];
+        charFlags = curArg + 2;
+      }
+      
+      /** Extract and return the next argument as a raw value. */
+      string_view nextRawArgument() {
+        flagAbsent = true;
+        valueSpecified = true;
+        flagIsCharacter = false;
+        key = string_view();
+        return value = argv[++position];
+      }
+      
+      bool hasValue() const {
+        return valueSpecified;
+      }
+      
+      string_view getValue() const {
+        return value;
+      }
+      
+      bool hasAnyFlag() const {
+        return !flagAbsent;
+      }
+      
+      bool hasLongFlag() const {
+        return !flagAbsent && !flagIsCharacter;
+      }
+      
+      bool hasShortFlag() const {
+        return !flagAbsent && flagIsCharacter;
+      }
+      
+      string_view getLongFlag() const {
+        return key;
+      }
+      
+      char getShortFlag() const {
+        return charKey;
+      }
+      
+      string quotedFlagName() const {
+        if (hasLongFlag()) {
+          return "\"" + string(getLongFlag()) + "\"";
+        }
+        if (hasShortFlag()) {
+          char res[4] = "'?'";
+          res[1] = getShortFlag();
+          return res;
+        }
+        return "<Unspecified>";
+      }
+      
+      unsigned tell() const {
+        return position;
+      }
+      
+      /// Prints an error for the current argument, which nothing accepted.
+      void reportUnexpected() const {
+        if (hasLongFlag()) {
+          fprintf(stderr, "Unexpected flag \"%.*s\"\n",
+              int(getLongFlag().length()), getLongFlag().data());
+        } else if (hasShortFlag()) {
+          fprintf(stderr, "Unexpected flag '%c'\n", getShortFlag());
+        } else if (hasValue()) {
+          fprintf(stderr, "Expected flag name, but got \"%.*s\"\n",
+              int(getValue().length()), getValue().data());
+        } else {
+          fputs("Internal error: "
+              "Not all arguments were read and argument reader is not sane.",
+              stderr);
+        }
+      }
+      
+      /**
+       * Returns whether the current flag is the first of its argument, rather
+       * than a later flag in a chain such as "-pb".
+       */
+      bool startsArgument() const {
+        return !flagIsCharacter || charFlags == argv[position] + 2;
+      }
+      
+      /**
+       * Skips the current flag, which must start its argument, together with
+       * the bare values which follow it unless it was given one with "=".
+       * @return the arguments skipped
+       */
+      ArgRange skipFlag() {
+        ArgRange skipped;
+        skipped.first = position;
+        skipped.count = 1;
+        const bool takeValues = !valueSpecified;
+        charFlags = "";
+        parseNextArg();
+        while (takeValues && !clearedOut && flagAbsent && !optionsEnded) {
+          skipped.count = position - skipped.first + 1;
+          parseNextArg();
+        }
+        return skipped;
+      }
+      
+      /**
+       * Returns the table in which values read from these arguments are
+       * interned, shared by every flag which keeps one of its strings.
+       */
+      const std::shared_ptr<InternTable> &internTable() {
+        if (!interned) {
+          interned = std::make_shared<InternTable>();
+        }
+        return interned;
+      }
+      
+      /// Returns the pool running checks on values from these arguments.
+      CheckPool &checkPool() {
+        if (!checks) {
+          checks = std::make_unique<CheckPool>();
+        }
+        return *checks;
+      }
+      
+      /// Returns the paths from these arguments waiting to be checked.
+      PathChecks &pathChecks() {
+        if (!paths) {
+          paths = std::make_unique<PathChecks>();
+        }
+        return *paths;
+      }
+      
+      /**
+       * Checks the paths given in these arguments, and waits for any checks
+       * started on their values, printing each failure.
+       * @return true if no check failed
+       */
+      bool finishChecks() {
+        const bool pathsUsable = !paths || paths->finish();
+        const bool accepted = !checks || checks->finish();
+        return pathsUsable && accepted;
+      }
+      
+      /// Returns whether "--" has been read, ending the flags.
+      bool pastOptions() const {
+        return optionsEnded;
+      }
+      
+      /**
+       * Returns the current argument and every one after it, waiting for the
+       * input to end if arguments are still arriving.
+       */
+      ArgSpan remaining() {
+        while (available(argc)) {}
+        return clearedOut ? ArgSpan()
+            : ArgSpan(argv + position, argc - position);
+      }
+      
+      ArgReader(int _argc, const char *const *const _argv):
+          argc(_argc < 0 ? 0 : _argc), argv(_argv) {}
+      
+      /// Reads the given arguments, then any more supplied by the source.
+      ArgReader(int _argc, const char *const *const _argv, ArgSource *_source):
+          argc(_argc < 0 ? 0 : _argc), argv(_argv), source(_source) {}
+    };
+    
+    template<typename P> class ValueRules;
+    
+    /**
+     * Reports that a flag, or a group if no name is given, cannot be parsed,
+     * as it was declared incorrectly.
+     */
+    inline void reportMisdeclared(const string &flag) {
+      if (flag.empty()) {
+        fputs("A flag group was declared incorrectly\n", stderr);
+      } else {
+        fprintf(stderr, "Flag %s was declared incorrectly\n", flag.c_str());
+      }
+    }
+    
+    class FlagBase {
+      const string _name;
+      const char _shortname;
+      bool _required = false;
+      const bool _positional;
+      
+      /// Set if this flag was declared with something it cannot honor.
+      bool _misdeclared = false;
+      
+      const string _description;
+      const string _valuename;
+      
+      inline void addThisTo(FlagGroup *group);
+    
+     protected:
+      typedef Internal::CtorArgs CtorArgs;
+      
+      /// Circumvents the fact that protected members can only be called on
+      /// pointers to the caller class.
+      static inline bool invokeParse(FlagBase *flag, ArgReader &argReader) {
+        return flag->parseArgsR(argReader);
+      }
+      
+      /// Circumvents the fact that protected members can only be called on
+      /// pointers to the caller class.
+      static bool pHasFlag(const FlagBase &fb, string_view flag) {
+        return fb.hasFlag(flag);
+      }
+      
+      /// Circumvents the fact that protected members can only be called on
+      /// pointers to the caller class.
+      static bool pHasFlag(const FlagBase &fb, char flag) {
+        return fb.hasFlag(flag);
+      }
+      
+      /// Circumvents the fact that protected members can only be called on
+      /// pointers to the caller class.
+      static bool pAtCapacity(const FlagBase &fb) {
+        return fb.atCapacity();
+      }
+      
+      /// Circumvents the fact that protected members can only be called on
+      /// pointers to the caller class.
+      static bool pValidate(const FlagBase &fb) {
+        return fb.validateDeclared();
+      }
+      
+      /**
+       * Marks this flag as declared with something it cannot honor, which has
+       * already been reported. Every parse which includes it then fails.
+       */
+      void markMisdeclared() {
+        _misdeclared = true;
+      }
+      
+      /// Fails if this flag was misdeclared, and otherwise validates it.
+      bool validateDeclared() const {
+        if (_misdeclared) {
+          reportMisdeclared(hasAnyName() || _positional ? quotedName() : "");
+          return false;
+        }
+        return validate();
+      }
+      
+      /**
+       * Parses as many values as possible from the given stream.
+       * @return true on success, false if an error occurred
+       * @note this function can return success even if no input is parsed
+       */
+      virtual bool parseArgsR(ArgReader& argReader) = 0;
+      
+      /** Returns false iff this flag can receieve an additional value. */
+      virtual bool atCapacity() const = 0;
+      
+      /**
+       * Returns true if this flag has anything to do with the given flag name,
+       * or false otherwise.
+       */
+      virtual bool hasFlag(string_view name) const = 0;
+      
+      /**
+       * Returns true if this flag has anything to do with the given flag name,
+       * or false otherwise.
+       */
+      virtual bool hasFlag(char name) const = 0;
+      
+      /**
+       * Takes the arguments left over after "--", which no positional flag
+       * accepted.
+       * @return true if they were kept, false if they are unexpected
+       */
+      virtual bool keepRemaining(ArgSpan) {
+        return false;
+      }
+      
+      /**
+       * Takes the current flag, which no flag in the tree accepted, and skips
+       * past it.
+       * @return true if it was kept, false if it is unexpected
+       */
+      virtual bool keepUnknown(ArgReader&) {
+        return false;
+      }
+      
+      /**
+       * Checks constraints on the values parsed, once parsing has finished,
+       * printing an error for any which are violated.
+       * @return true if the values are valid, false otherwise
+       */
+      virtual bool validate() const {
+        return true;
+      }
+      
+      /**
+       * Print help text for this flag to the given stream. Prefix the given
+       * indentation.
+       */
+      virtual void printHelp(HelpPrinter &printer) const {
+        printer.enterFlag(makeProps());
+        if (hasDescription()) {
+          printer.writeBlock(getDescription());
+        }
+        printer.leaveFlag();
+      }
+      
+      FlagProperties makeProps(bool greedy = false, bool reentrant = false,
+                               char delimiter = 0) const {
+        return FlagProperties(_name, _shortname, _valuename, greedy, reentrant,
+                              delimiter);
+      }
+      
+      static void printHelpR(const FlagBase *flag, HelpPrinter &printer) {
+        flag->printHelp(printer);
+      }
+      
+      /**
+       * Perform the neccessary steps to ensure the contents of this flag will
+       * be parsed if the flags are present. Normally this is the same as a call
+       * to `addThisTo()`. An example of where this is not the case would be an
+       * anonymous flag group, which adds its contents to the given group.
+       */
+      virtual bool addSelfTo(FlagGroup *group) {
+        addThisTo(group);
+        return true;
+      }
+      
+      class Instantiator {
+       public:
+        template<class T> static T instantiate(CtorArgs args) {
+          return T(args);
+        }
+      };
+      
+      CtorArgs getCtorArgs(FlagGroup *group) const {
+        return CtorArgs(group, _name, _shortname);
+      }
+      
+      /**
+       * Returns the record of the declaration this flag was built from, which
+       * every other instance of that declaration shares. Must be called once
+       * this flag has been added to its group.
+       */
+      inline std::shared_ptr<Declaration> declarationOf(const CtorArgs &args);
+      
+      /**
+       * Returns the restrictions on values given in the arguments, built once
+       * for this flag's declaration, and marks this flag misdeclared if its
+       * values cannot satisfy them.
+       */
+      template<typename P>
+      std::shared_ptr<const ValueRules<P>> valueRules(const CtorArgs &args);
+      
+      /**
+       * Builds a flag from the given arguments, which may call only the
+       * builder methods in FlagOption given as `supported`.
+       */
+      FlagBase(CtorArgs construct, unsigned supported = 0):
+          _name(construct._longName), _shortname(construct._shortName),
+          _required(construct._required),
+          _positional(construct._positional),
+          _description(construct._description),
+          _valuename(construct._valuename) {
+        if (construct._group) {
+          addThisTo(construct._group);
+        }
+        rejectOptions(construct.options() & ~supported);
+      }
+      
+      /// Reports each of the given options, which this flag does not support.
+      void rejectOptions(unsigned options) {
+        static const char *const kNames[] = {
+          "splitOn()", "range() or oneOf()", "matches()", "checkAsync()",
+          "mustExist() or mustBeReadable()",
+        };
+        for (unsigned i = 0; options >> i; ++i) {
+          if (options >> i & 1) {
+            fprintf(stderr, "Internal error: flag %s does not support %s\n",
+                quotedName().c_str(), kNames[i]);
+            markMisdeclared();
+          }
+        }
+      }
+      
+     public:
+
+      bool hasShortName() const {
+        return _shortname;
+      }
+
+      char getShortName() const {
+        return _shortname;
+      }
+
+      bool hasLongName() const {
+        return _name.length();
+      }
+
+      const string &getLongName() const {
+        return _name;
+      }
+
+      bool hasAnyName() const {
+        return _name.length() || _shortname;
+      }
+      
+      bool isRequired() const {
+        return _required;
+      }
+      
+      /// Returns whether this flag takes values given without a flag name.
+      bool isPositional() const {
+        return _positional;
+      }
+      
+      /// Returns the name of this flag, quoted for use in error messages.
+      string quotedName() const {
+        if (hasLongName()) {
+          return "\"" + _name + "\"";
+        }
+        if (!_shortname) {
+          return "<" + _valuename + ">";
+        }
+        char res[4] = "'?'";
+        res[1] = _shortname;
+        return res;
+      }
+      
+      bool hasDescription() const {
+        return _description.length();
+      }
+      
+      string getDescription() const {
+        return _description;
+      }
+      
+      bool hasValueName() const {
+        return _valuename.length();
+      }
+      
+      string getValueName() const {
+        return _valuename;
+      }
+
+      /**
+       * Restores this flag to the state it was in before any arguments were
+       * parsed, so that the same instance can be used to parse another set of
+       * arguments. Storage already allocated for values is kept where the
+       * value type allows it.
+       */
+      virtual void reset() = 0;
+
+      bool parseArgs(int argc, const char* const* const argv) {
+        if (argc < 2) {
+          return validateDeclared();
+        }
+        ArgReader argReader(argc, argv);
+        return parseArgs(argReader);
+      }
+      
+      /**
+       * Parses every argument the given reader has not yet read, reporting
+       * any which are left over. Returns once every check started with
+       * checkAsync() has finished, even if parsing failed.
+       */
+      bool parseArgs(ArgReader &argReader) {
+        const bool parsed = parseAll(argReader);
+        const bool checked = argReader.finishChecks();
+        return parsed && checked;
+      }
+
+      virtual ~FlagBase() {}
+      
+     private:
+      bool parseAll(ArgReader &argReader) {
+        argReader.parseNextArg();
+        if (argReader.atEnd()) {
+          return validateDeclared();
+        }
+        do {
+          if (!parseArgsR(argReader)) {
+            return false;
+          }
+        } while (!argReader.atEnd() && argReader.hasAnyFlag()
+            && keepUnknown(argReader));
+        if (!argReader.atEnd() && argReader.pastOptions()
+            && keepRemaining(argReader.remaining())) {
+          return validateDeclared();
+        }
+        if (!argReader.atEnd()) {
+          argReader.reportUnexpected();
+          return false;
+        }
+        return validateDeclared();
+      }
+    };
+    
+    /**
+     * Reads a run of values for the given flag, up to the next flag name,
+     * passing each to `handle` as it is read. Values are split on the
+     * delimiter, if one is given.
+     * @return true on success, false if a value was missing or `handle`
+     *         rejected one
+     */
+    template<typename Handler> bool forEachValue(ArgReader &argReader,
+        const FlagBase &flag, char delimiter, Handler &&handle) {
+      for (;;) {
+        string_view raw;
+        if (argReader.hasValue()) {
+          raw = argReader.getValue();
+        } else if (argReader.hasMoreArguments()) {
+          raw = argReader.nextRawArgument();
+        } else {
+          fprintf(stderr, "Flag %s expects a value\n",
+                  flag.quotedName().c_str());
+          return false;
+        }
+        for (size_t start = 0;;) {
+          const size_t end = delimiter ? raw.find(delimiter, start)
+                                       : string_view::npos;
+          if (!handle(raw.substr(start, end - start))) {
+            return false;
+          }
+          if (end == string_view::npos) {
+            break;
+          }
+          start = end + 1;
+        }
+        argReader.parseNextArg();
+        if (argReader.hasAnyFlag()) {
+          return true;
+        }
+      }
+    }
+    
+    /**
+     * Looks up the boolean value named by the given text, case-insensitively.
+     * @return true if the text names a boolean value, false otherwise
+     */
+    inline bool lookupBool(string_view text, bool &result) {
+      // Every name fits in a word, so the text is folded to lowercase and
+      // packed into one, then matched with a single switch.
+      constexpr auto pack = [](string_view name) {
+        uint64_t key = 0;
+        for (size_t i = 0; i < name.length(); ++i) {
+          key |= uint64_t(uint8_t(name[i])) << (8 * i);
+        }
+        return key;
+      };
+      if (text.empty() || text.length() > 5) {
+        return false;
+      }
+      uint64_t key = 0;
+      for (size_t i = 0; i < text.length(); ++i) {
+        uint8_t c = text[i];
+        key |= uint64_t(unsigned(c - 'A') < 26 ? c | 0x20 : c) << (8 * i);
+      }
+      switch (key) {
+        case pack("1"): case pack("on"): case pack("yes"): case pack("true"):
+          result = true;
+          return true;
+        case pack("0"): case pack("no"): case pack("off"): case pack("false"):
+          result = false;
+          return true;
+        default:
+          return false;
+      }
+    }
+    
+    /**
+     * Parses an integer following the conventions of strtoll in base zero: an
+     * optional sign, followed by a hexadecimal (0x), octal (leading 0), or
+     * decimal number. Unlike strtoll, the entire text must be consumed.
+     * @return true on success, false if the text is malformed or out of range
+     */
+    template<typename T> bool parseInteger(string_view text, T &result) {
+      const char *first = text.data();
+      const char *const last = first + text.length();
+      bool negative = false;
+      if (first != last && (*first == '-' || *first == '+')) {
+        negative = *first++ == '-';
+      }
+      int base = 10;
+      if (last - first > 1 && *first == '0') {
+        if (first[1] == 'x' || first[1] == 'X') {
+          base = 16;
+          first += 2;
+        } else {
+          base = 8;
+          ++first;
+        }
+      }
+      
+      unsigned long long magnitude;
+      auto res = std::from_chars(first, last, magnitude, base);
+      if (res.ec != std::errc() || res.ptr != last || first == last) {
+        return false;
+      }
+      
+      typedef typename std::make_unsigned<T>::type U;
+      if (!negative) {
+        if (magnitude > U(std::numeric_limits<T>::max())) {
+          return false;
+        }
+        result = T(magnitude);
+      } else if (std::is_signed<T>::value) {
+        if (magnitude > U(std::numeric_limits<T>::max()) + 1ull) {
+          return false;
+        }
+        result = T(0ull - magnitude);
+      } else if (magnitude) {
+        return false;
+      } else {
+        result = 0;
+      }
+      return true;
+    }
+    
+    /**
+     * Parses a floating-point number, optionally preceded by a plus sign. The
+     * entire text must be consumed.
+     * @return true on success, false if the text is malformed or out of range
+     */
+    template<typename T> bool parseFloat(string_view text, T &result) {
+      const char *first = text.data();
+      const char *const last = first + text.length();
+      if (first != last && *first == '+' && last - first > 1
+          && first[1] != '-') {
+        ++first;
+      }
+      auto res = std::from_chars(first, last, result);
+      return res.ec == std::errc() && res.ptr == last && first != last;
+    }
+    
+    /// FNV-1a, salted so that a seed can be found which separates names.
+    constexpr uint32_t hashName(string_view name, uint32_t seed) {
+      uint32_t hash = 2166136261u ^ seed;
+      for (char c : name) {
+        hash = (hash ^ uint8_t(c)) * 16777619u;
+      }
+      return hash ^ (hash >> 16);
+    }
+    
+    /**
+     * Looks up enumerators by name through a perfect hash of the names in
+     * EnumNames<E>, built at compile time. A lookup costs one hash of the
+     * text and one comparison, whatever the number of names.
+     */
+    template<typename E> class EnumIndex {
+      static constexpr const EnumName<E> *names = EnumNames<E>::values;
+      static constexpr size_t kCount = std::size(EnumNames<E>::values);
+      static_assert(kCount <= 256,
+          "Enums of more than 256 names are not supported as flags");
+      
+      /// Keeps collisions rare enough that a seed is found in a few tries.
+      static constexpr size_t slotsFor(size_t count) {
+        size_t slots = 2;
+        while (slots < 2 * count || slots < count * count / 2) {
+          slots *= 2;
+        }
+        return slots;
+      }
+      static constexpr size_t kSlots = slotsFor(kCount);
+      
+      /// Maps each hash slot to one more than the index of its name, or 0.
+      struct Table {
+        uint32_t seed = 0;
+        uint16_t slots[kSlots] = {};
+      };
+      
+      static constexpr bool distinct() {
+        for (size_t i = 0; i < kCount; ++i) {
+          for (size_t j = i + 1; j < kCount; ++j) {
+            if (names[i].name == names[j].name) {
+              return false;
+            }
+          }
+        }
+        return true;
+      }
+      static_assert(distinct(), "Enum names given as flags must be distinct");
+      
+      static constexpr Table build() {
+        Table table;
+        for (;; ++table.seed) {
+          for (uint16_t &slot : table.slots) {
+            slot = 0;
+          }
+          bool collided = false;
+          for (size_t i = 0; i < kCount && !collided; ++i) {
+            uint16_t &slot = table.slots[
+                hashName(names[i].name, table.seed) & (kSlots - 1)];
+            collided = slot;
+            slot = uint16_t(i + 1);
+          }
+          if (!collided) {
+            return table;
+          }
+        }
+      }
+      static constexpr Table table = build();
+      
+     public:
+      /// One more than the greatest enumerator named, or 0 if any is negative.
+      static constexpr size_t bitCount() {
+        size_t bits = 0;
+        for (size_t i = 0; i < kCount; ++i) {
+          auto value = std::underlying_type_t<E>(names[i].value);
+          if (value < 0) {
+            return 0;
+          }
+          bits = std::max(bits, size_t(value) + 1);
+        }
+        return bits;
+      }
+      
+      /// @return true if the text names an enumerator, false otherwise
+      static bool lookup(string_view text, E &result) {
+        const uint16_t slot =
+            table.slots[hashName(text, table.seed) & (kSlots - 1)];
+        if (!slot || names[slot - 1].name != text) {
+          return false;
+        }
+        result = names[slot - 1].value;
+        return true;
+      }
+      
+      /// Returns every name, separated by bars, for use in help text.
+      static string listNames() {
+        string res;
+        for (size_t i = 0; i < kCount; ++i) {
+          res += (i ? "|" : "") + string(names[i].name);
+        }
+        return res;
+      }
+    };
+    
+    template<typename T, typename = void> class ParseType;
+    
+    template<> struct ParseType<bool> {
+      bool error = false;
+      bool value = false;
+      ParseType(string_view val) {
+        error = !lookupBool(val, value);
+      }
+    };
+    
+    template<> struct ParseType<char> {
+      bool error = false;
+      char value = 0;
+      ParseType(string_view val) {
+        if (val.length() != 1) {
+          error = true;
+        } else {
+          value = val[0];
+        }
+      }
+    };
+    
+    template<typename T> struct ParseIntType {
+      bool error = false;
+      T value = 0;
+      ParseIntType(string_view val) {
+        error = !parseInteger(val, value);
+      }
+    };
+    
+#   define df_internal_DEFINE_PRIM_PARSER(T) \
+    template<> struct ParseType<T>: ParseIntType<T> { \
+      ParseType(string_view val): ParseIntType(val) {} \
+    }
+    
+    df_internal_DEFINE_PRIM_PARSER(int8_t);
+    df_internal_DEFINE_PRIM_PARSER(int16_t);
+    df_internal_DEFINE_PRIM_PARSER(int32_t);
+    df_internal_DEFINE_PRIM_PARSER(int64_t);
+    
+    df_internal_DEFINE_PRIM_PARSER(uint8_t);
+    df_internal_DEFINE_PRIM_PARSER(uint16_t);
+    df_internal_DEFINE_PRIM_PARSER(uint32_t);
+    df_internal_DEFINE_PRIM_PARSER(uint64_t);
+    
+#   undef df_internal_DEFINE_PRIM_PARSER
+
+    template<typename T> struct ParseFloatType {
+      bool error = false;
+      T value = 0;
+      ParseFloatType(string_view val) {
+        error = !parseFloat(val, value);
+      }
+    };
+    
+    template<> struct ParseType<float>: ParseFloatType<float> {
+      ParseType(string_view val): ParseFloatType(val) {}
+    };
+    
+    template<> struct ParseType<double>: ParseFloatType<double> {
+      ParseType(string_view val): ParseFloatType(val) {}
+    };
+    
+    template<> struct ParseType<long double>: ParseFloatType<long double> {
+      ParseType(string_view val): ParseFloatType(val) {}
+    };
+    
+    template<> struct ParseType<string> {
+      bool error = false;
+      string value;
+      ParseType(string_view val): value(val) {}
+    };
+    
+    /// Refers to the argument itself, without copying it.
+    template<> struct ParseType<string_view> {
+      bool error = false;
+      string_view value;
+      ParseType(string_view val): value(val) {}
+    };
+    
+    template<> struct ParseType<Path> {
+      bool error = false;
+      Path value;
+      ParseType(string_view val): value(val) {}
+    };
+    
+    /// Accepts any name listed for the enum in EnumNames.
+    template<typename E>
+    struct ParseType<E, std::enable_if_t<std::is_enum<E>::value>> {
+      bool error;
+      E value = E();
+      ParseType(string_view val) {
+        error = !EnumIndex<E>::lookup(val, value);
+      }
+    };
+    
+    /// Holds a value once one is given.
+    template<typename T> struct ParseType<std::optional<T>> {
+      bool error;
+      std::optional<T> value;
+      ParseType(string_view val) {
+        ParseType<T> parsed(val);
+        error = parsed.error;
+        if (!error) {
+          value.emplace(std::move(parsed.value));
+        }
+      }
+    };
+    
+    /**
+     * Tries each alternative of the variant in order, keeping the first which
+     * accepts the text. None of the conversions throw, so a rejection costs
+     * no more than the attempt itself.
+     */
+    template<typename... A> struct ParseType<std::variant<A...>> {
+      bool error = true;
+      std::variant<A...> value;
+      
+      ParseType(string_view val) {
+        tryAlternatives(val, std::index_sequence_for<A...>());
+      }
+      
+     private:
+      template<size_t... I>
+      void tryAlternatives(string_view val, std::index_sequence<I...>) {
+        (tryAlternative<I>(val) || ...);
+      }
+      
+      template<size_t I> bool tryAlternative(string_view val) {
+        ParseType<std::variant_alternative_t<I, std::variant<A...>>>
+            parsed(val);
+        if (parsed.error) {
+          return false;
+        }
+        value.template emplace<I>(std::move(parsed.value));
+        error = false;
+        return true;
+      }
+    };
+    
+    /**
+     * Converts a raw value into the given element.
+     * @return true on success, false if the value is malformed
+     */
+    template<typename T> bool convertValue(string_view raw, T &out) {
+      ParseType<T> parsed(raw);
+      if (parsed.error) {
+        return false;
+      }
+      out = std::move(parsed.value);
+      return true;
+    }
+    
+    /**
+     * Batch conversion of short decimal integers. Each value is copied,
+     * right-aligned, into a block of sixteen '0' characters; a kernel then
+     * validates and converts whole blocks with vector instructions. The best
+     * kernel the CPU supports is chosen on first use.
+     */
+    namespace Digits {
+      constexpr size_t kBlockSize = 16;
+      
+      /// Up to sixteen decimal digits, right-aligned and padded with '0'.
+      struct alignas(kBlockSize) Block {
+        char digits[kBlockSize];
+      };
+      
+      /// Stored by a kernel for a block containing anything but digits.
+      constexpr uint64_t kInvalid = ~uint64_t(0);
+      
+      /// Converts `count` blocks into their values, or kInvalid.
+      typedef void (*Kernel)(const Block *blocks, uint64_t *values,
+                             size_t count);
+      
+      inline void convertScalar(
+          const Block *blocks, uint64_t *values, size_t count) {
+        for (size_t b = 0; b < count; ++b) {
+          uint64_t value = 0;
+          for (size_t i = 0; i < kBlockSize; ++i) {
+            unsigned digit = (unsigned char) blocks[b].digits[i] - '0';
+            if (digit > 9) {
+              value = kInvalid;
+              break;
+            }
+            value = value * 10 + digit;
+          }
+          values[b] = value;
+        }
+      }
+      
+#   if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+        && !defined(DEEPFLAGS_NO_SIMD)
+      
+      /**
+       * Combines sixteen digit values, most significant first, into two
+       * eight-digit values in the low two 32-bit lanes.
+       */
+      __attribute__((target("sse4.1")))
+      inline __m128i combineDigits(__m128i digits) {
+        const __m128i tens = _mm_setr_epi8(
+            10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1);
+        const __m128i hundreds = _mm_setr_epi16(
+            100, 1, 100, 1, 100, 1, 100, 1);
+        const __m128i tenThousands = _mm_setr_epi16(
+            10000, 1, 10000, 1, 10000, 1, 10000, 1);
+        __m128i pairs = _mm_maddubs_epi16(digits, tens);
+        __m128i quads = _mm_madd_epi16(pairs, hundreds);
+        __m128i packed = _mm_packus_epi32(quads, quads);
+        return _mm_madd_epi16(packed, tenThousands);
+      }
+      
+      __attribute__((target("sse4.1")))
+      inline void convertSse41(
+          const Block *blocks, uint64_t *values, size_t count) {
+        const __m128i zeros = _mm_set1_epi8('0');
+        const __m128i nines = _mm_set1_epi8(9);
+        for (size_t b = 0; b < count; ++b) {
+          __m128i digits = _mm_sub_epi8(
+              _mm_load_si128((const __m128i*) blocks[b].digits), zeros);
+          // Anything below '0' wraps around, so one unsigned max suffices.
+          __m128i valid = _mm_cmpeq_epi8(_mm_max_epu8(digits, nines), nines);
+          if (_mm_movemask_epi8(valid) != 0xFFFF) {
+            values[b] = kInvalid;
+            continue;
+          }
+          __m128i halves = combineDigits(digits);
+          values[b] = uint64_t(uint32_t(_mm_cvtsi128_si32(halves))) * 100000000
+              + uint32_t(_mm_extract_epi32(halves, 1));
+        }
+      }
+      
+      __attribute__((target("avx2")))
+      inline void convertAvx2(
+          const Block *blocks, uint64_t *values, size_t count) {
+        const __m256i zeros = _mm256_set1_epi8('0');
+        const __m256i nines = _mm256_set1_epi8(9);
+        const __m256i tens = _mm256_setr_epi8(
+            10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1,
+            10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1);
+        const __m256i hundreds = _mm256_setr_epi16(
+            100, 1, 100, 1, 100, 1, 100, 1, 100, 1, 100, 1, 100, 1, 100, 1);
+        const __m256i tenThousands = _mm256_setr_epi16(
+            10000, 1, 10000, 1, 10000, 1, 10000, 1,
+            10000, 1, 10000, 1, 10000, 1, 10000, 1);
+        
+        // Two blocks per register, one in each 128-bit lane.
+        size_t b = 0;
+        for (; b + 2 <= count; b += 2) {
+          __m256i digits = _mm256_sub_epi8(
+              _mm256_loadu_si256((const __m256i*) blocks[b].digits), zeros);
+          __m256i valid = _mm256_cmpeq_epi8(
+              _mm256_max_epu8(digits, nines), nines);
+          unsigned mask = _mm256_movemask_epi8(valid);
+          
+          __m256i pairs = _mm256_maddubs_epi16(digits, tens);
+          __m256i quads = _mm256_madd_epi16(pairs, hundreds);
+          __m256i packed = _mm256_packus_epi32(quads, quads);
+          __m256i halves = _mm256_madd_epi16(packed, tenThousands);
+          
+          values[b] = (mask & 0xFFFF) != 0xFFFF ? kInvalid
+              : uint64_t(uint32_t(_mm256_extract_epi32(halves, 0))) * 100000000
+                + uint32_t(_mm256_extract_epi32(halves, 1));
+          values[b + 1] = (mask >> 16) != 0xFFFF ? kInvalid
+              : uint64_t(uint32_t(_mm256_extract_epi32(halves, 4))) * 100000000
+                + uint32_t(_mm256_extract_epi32(halves, 5));
+        }
+        convertSse41(blocks + b, values + b, count - b);
+      }
+      
+      inline Kernel selectKernel() {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+          return convertAvx2;
+        }
+        if (__builtin_cpu_supports("sse4.1")) {
+          return convertSse41;
+        }
+        return convertScalar;
+      }
+#   else
+      inline Kernel selectKernel() {
+        return convertScalar;
+      }
+#   endif
+      
+      /// Returns the best kernel available.
+      inline Kernel kernel() {
+        static const Kernel best = selectKernel();
+        return best;
+      }
+      
+      /**
+       * Prepares a block for the given text, if it is a plain decimal number
+       * that fits in one. Numbers with leading zeros are octal, and are left
+       * to parseInteger() along with anything else unusual.
+       * @return true if the text fits a block, false otherwise
+       */
+      inline bool fill(string_view text, Block &block, bool &negative) {
+        negative = false;
+        if (!text.empty() && (text[0] == '-' || text[0] == '+')) {
+          negative = text[0] == '-';
+          text.remove_prefix(1);
+        }
+        if (text.empty() || text.length() > kBlockSize
+            || (text[0] == '0' && text.length() > 1)) {
+          return false;
+        }
+        memset(block.digits, '0', kBlockSize);
+        memcpy(block.digits + kBlockSize - text.length(), text.data(),
+               text.length());
+        return true;
+      }
+      
+      /**
+       * Applies a sign to the magnitude of a decimal number, checking that the
+       * result is representable as a T.
+       */
+      template<typename T> bool narrow(uint64_t magnitude, bool negative,
+                                       T &result) {
+        typedef typename std::make_unsigned<T>::type U;
+        if (!negative) {
+          if (magnitude > U(std::numeric_limits<T>::max())) {
+            return false;
+          }
+          result = T(magnitude);
+        } else if (std::is_signed<T>::value) {
+          if (magnitude > U(std::numeric_limits<T>::max()) + uint64_t(1)) {
+            return false;
+          }
+          result = T(0 - magnitude);
+        } else if (magnitude) {
+          return false;
+        } else {
+          result = 0;
+        }
+        return true;
+      }
+    }
+    
+    /**
+     * Converts the raw integers in [begin, end) into the same positions of
+     * out, converting short decimal values in batches.
+     * @return the index of the first value that failed to convert, or `fail`
+     *         if all of them converted
+     */
+    template<typename T> size_t convertIntegers(const string_view *raw,
+        T *out, size_t begin, size_t end, size_t fail) {
+      const Digits::Kernel kernel = Digits::kernel();
+      if (kernel == Digits::convertScalar) {
+        // Batching only pays off with vector instructions.
+        for (size_t i = begin; i < end; ++i) {
+          if (!parseInteger(raw[i], out[i])) {
+            return i;
+          }
+        }
+        return fail;
+      }
+      
+      constexpr size_t kBatch = 64;
+      Digits::Block blocks[kBatch];
+      uint64_t values[kBatch];
+      size_t slots[kBatch];
+      bool negative[kBatch];
+      
+      for (size_t start = begin; start < end; start += kBatch) {
+        const size_t count = std::min(kBatch, end - start);
+        size_t filled = 0;
+        for (size_t i = 0; i < count; ++i) {
+          slots[i] = filled;
+          if (Digits::fill(raw[start + i], blocks[filled], negative[filled])) {
+            ++filled;
+          } else {
+            slots[i] = kBatch;
+          }
+        }
+        kernel(blocks, values, filled);
+        
+        for (size_t i = 0; i < count; ++i) {
+          const size_t slot = slots[i];
+          const bool converted = slot != kBatch
+              && values[slot] != Digits::kInvalid
+              ? Digits::narrow(values[slot], negative[slot], out[start + i])
+              : parseInteger(raw[start + i], out[start + i]);
+          if (!converted) {
+            return start + i;
+          }
+        }
+      }
+      return fail;
+    }
+    
+    /**
+     * Appends the pieces of the given text between occurrences of the
+     * delimiter to `pieces`, as views into the text. The delimiter is found
+     * sixteen characters at a time where SSE2 is available.
+     */
+    inline void splitValue(string_view text, char delimiter,
+                           std::vector<string_view> &pieces) {
+      const char *const data = text.data();
+      const size_t length = text.length();
+      size_t start = 0, i = 0;
+#   if defined(__SSE2__) && !defined(DEEPFLAGS_NO_SIMD)
+      const __m128i needle = _mm_set1_epi8(delimiter);
+      for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) (data + i));
+        unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle));
+        while (mask) {
+          const size_t at = i + __builtin_ctz(mask);
+          pieces.emplace_back(data + start, at - start);
+          start = at + 1;
+          mask &= mask - 1;
+        }
+      }
+#   endif
+      for (; i < length; ++i) {
+        if (data[i] == delimiter) {
+          pieces.emplace_back(data + start, i - start);
+          start = i + 1;
+        }
+      }
+      pieces.emplace_back(data + start, length - start);
+    }
+    
+    /**
+     * Converts the raw values in [begin, end) into the same positions of out.
+     * @return the index of the first value that failed to convert, or `fail`
+     *         if all of them converted
+     */
+    template<typename T> size_t convertRange(const string_view *raw, T *out,
+        size_t begin, size_t end, size_t fail) {
+      if constexpr (std::is_integral<T>::value
+          && !std::is_same<T, bool>::value && !std::is_same<T, char>::value) {
+        return convertIntegers(raw, out, begin, end, fail);
+      }
+      for (size_t i = begin; i < end; ++i) {
+        if (!convertValue(raw[i], out[i])) {
+          return i;
+        }
+      }
+      return fail;
+    }
+    
+    /**
+     * Returns how many pieces to split the conversion of the given number of
+     * values into. Runs shorter than DEEPFLAGS_PARALLEL_MIN_VALUES are not
+     * worth the cost of starting threads.
+     */
+    inline unsigned conversionChunks(size_t count) {
+#     ifdef DEEPFLAGS_NO_THREADS
+        (void) count;
+        return 1;
+#     else
+        if (count < DEEPFLAGS_PARALLEL_MIN_VALUES) {
+          return 1;
+        }
+        return std::max(1u, std::thread::hardware_concurrency());
+#     endif
+    }
+    
+    /**
+     * Converts `count` raw values into `out`, splitting the work into up to
+     * `chunks` contiguous pieces which are converted concurrently. Failures are
+     * compared by index, so the result does not depend on how the work was
+     * split or scheduled.
+     * @return the index of the first value that failed to convert, or `count`
+     *         if all of them converted
+     */
+    template<typename T> size_t convertValues(
+        const string_view *raw, T *out, size_t count, unsigned chunks) {
+      if (chunks <= 1 || count < chunks) {
+        return convertRange(raw, out, 0, count, count);
+      }
+      
+      std::vector<size_t> failures(chunks, count);
+      auto convertChunk = [&](unsigned chunk) {
+        failures[chunk] = convertRange(raw, out,
+            count * chunk / chunks, count * (chunk + 1) / chunks, count);
+      };
+      
+#     if defined(DEEPFLAGS_PARALLEL_STL)
+        std::vector<unsigned> ids(chunks);
+        for (unsigned i = 0; i < chunks; ++i) {
+          ids[i] = i;
+        }
+        std::for_each(std::execution::par, ids.begin(), ids.end(),
+                      convertChunk);
+#     elif !defined(DEEPFLAGS_NO_THREADS)
+        // If threads cannot be started, the remaining chunks are converted
+        // on this one.
+        std::vector<std::thread> threads;
+        try {
+          for (unsigned i = 1; i < chunks; ++i) {
+            threads.emplace_back(convertChunk, i);
+          }
+        } catch (const std::system_error&) {}
+        for (unsigned i = threads.size() + 1; i < chunks; ++i) {
+          convertChunk(i);
+        }
+        convertChunk(0);
+        for (std::thread &thread : threads) {
+          thread.join();
+        }
+#     else
+        for (unsigned i = 0; i < chunks; ++i) {
+          convertChunk(i);
+        }
+#     endif
+      
+      return *std::min_element(failures.begin(), failures.end());
+    }
+    
+#   ifndef DEEPFLAGS_NO_REGEX
+    /**
+     * Returns the compiled form of the given regex. Each pattern is compiled
+     * once, and shared by every flag using it, such as the same flag in each
+     * element of a repeated group.
+     * @return the regex, or null if the pattern is malformed
+     */
+    inline std::shared_ptr<const std::regex> sharedRegex(
+        const string &pattern) {
+      static std::map<string, std::shared_ptr<const std::regex>> cache;
+#     ifndef DEEPFLAGS_NO_THREADS
+        static std::mutex mutex;
+        std::lock_guard<std::mutex> lock(mutex);
+#     endif
+      auto found = cache.find(pattern);
+      if (found != cache.end()) {
+        return found->second;
+      }
+      std::shared_ptr<const std::regex> res;
+      try {
+        res = std::make_shared<const std::regex>(pattern,
+            std::regex::ECMAScript | std::regex::optimize);
+      } catch (const std::regex_error &e) {
+        fprintf(stderr, "Invalid pattern /%s/: %s\n", pattern.c_str(),
+                e.what());
+      }
+      return cache[pattern] = res;
+    }
+#   endif
+    
+    /**
+     * The restrictions placed on the values of a flag by the range(), oneOf(),
+     * and matches() builder methods. Whole arrays of values are checked at
+     * once, after conversion.
+     */
+    template<typename P> class ValueRules: public DeclaredRules {
+      /// Identifies rules for this type among DeclaredRules.
+      static constexpr char kType = 0;
+      
+      /// Bounds and lists of values apply only to ordered types.
+      static constexpr bool ordered =
+          std::is_arithmetic<P>::value || std::is_same<P, string>::value;
+      
+     public:
+      /// The builder methods in FlagOption which these rules can enforce.
+      static constexpr unsigned kOptions =
+          kMatches | kCheckAsync | (ordered ? unsigned(kRestrict) : 0)
+          | (std::is_same<P, Path>::value ? unsigned(kPathChecks) : 0);
+      
+     private:
+      
+      bool bounded = false;
+      P min = P(), max = P();
+      std::vector<P> allowed;
+      
+      /// The bounds and values as given, for error messages.
+      string minText, maxText, allowedText;
+      std::vector<string> allowedTexts;
+      
+      /// Set if a restriction was given which this type cannot hold.
+      bool misdeclared = false;
+      
+      bool patterned = false;
+      string patternText;
+#   ifndef DEEPFLAGS_NO_REGEX
+      std::shared_ptr<const std::regex> pattern;
+#   endif
+      
+      std::shared_ptr<const CheckPool::Check> asyncCheck;
+      unsigned pathChecks = 0;
+      
+      bool parseBound(const string &text, P &out, const string &flag) {
+        ParseType<P> parsed(text);
+        if (parsed.error) {
+          fprintf(stderr, "Internal error: flag %s cannot accept its own "
+              "restriction \"%s\"\n", flag.c_str(), text.c_str());
+          misdeclared = true;
+          return false;
+        }
+        out = std::move(parsed.value);
+        return true;
+      }
+      
+      /// Returns whether these rules were built from the given restrictions.
+      bool builtFrom(const CtorArgs &args) const {
+        return bounded == args._bounded && minText == args._min
+            && maxText == args._max && allowedTexts == args._allowed
+            && patternText == args._pattern
+            && pathChecks == args._pathChecks;
+      }
+      
+      /// Returns whether the value is within bounds, which NaN never is.
+      bool inRange(const P &value) const {
+        return min <= value && value <= max;
+      }
+      
+      bool isAllowed(const P &value) const {
+        return std::binary_search(allowed.begin(), allowed.end(), value);
+      }
+      
+      bool matchesPattern(string_view raw) const {
+#     ifndef DEEPFLAGS_NO_REGEX
+        return pattern && std::regex_match(raw.begin(), raw.end(), *pattern);
+#     else
+        (void) raw;
+        return true;
+#     endif
+      }
+      
+      /// Returns the index of the first value out of range, or `count`.
+      size_t firstOutOfRange(const P *values, size_t count) const {
+        // Flag violations a block at a time, without branching, so that the
+        // comparisons can be vectorized; then find the one at fault.
+        constexpr size_t kBlock = 64;
+        for (size_t start = 0; start < count; start += kBlock) {
+          const size_t end = std::min(count, start + kBlock);
+          bool violated = false;
+          for (size_t i = start; i < end; ++i) {
+            violated |= !inRange(values[i]);
+          }
+          if (violated) {
+            for (size_t i = start; ; ++i) {
+              if (!inRange(values[i])) {
+                return i;
+              }
+            }
+          }
+        }
+        return count;
+      }
+      
+     public:
+      /**
+       * Reads the restrictions from the given arguments, reporting any that do
+       * not make sense for this type.
+       */
+      ValueRules(const CtorArgs &args, const string &flag):
+          DeclaredRules { &kType } {
+        if constexpr (ordered) {
+          for (const string &text : args._allowed) {
+            P value;
+            if (parseBound(text, value, flag)) {
+              allowed.push_back(std::move(value));
+            }
+            allowedText += (allowedText.empty() ? "" : ", ") + text;
+          }
+          std::sort(allowed.begin(), allowed.end());
+          if (args._bounded) {
+            parseBound(args._min, min, flag);
+            parseBound(args._max, max, flag);
+          }
+        }
+        bounded = args._bounded;
+        minText = args._min;
+        maxText = args._max;
+        allowedTexts = args._allowed;
+        if (!args._pattern.empty()) {
+          patterned = true;
+          patternText = args._pattern;
+#       ifndef DEEPFLAGS_NO_REGEX
+          pattern = sharedRegex(args._pattern);
+#       endif
+        }
+        asyncCheck = args._checkAsync;
+        pathChecks = args._pathChecks;
+      }
+      
+      /**
+       * Returns the rules for the given arguments, building them only if the
+       * declaration has none built from the same restrictions. A function
+       * given to checkAsync() belongs to the instance, not the declaration.
+       */
+      static std::shared_ptr<const ValueRules> declared(const CtorArgs &args,
+          Declaration &declaration, const string &flag) {
+        auto rules = declaration.rules && declaration.rules->type == &kType
+            ? std::static_pointer_cast<const ValueRules>(declaration.rules)
+            : nullptr;
+        if (!rules || !rules->builtFrom(args)) {
+          auto built = std::make_shared<ValueRules>(args, flag);
+          declaration.rules = built;
+          return built;
+        }
+        if (rules->asyncCheck != args._checkAsync) {
+          auto own = std::make_shared<ValueRules>(*rules);
+          own->asyncCheck = args._checkAsync;
+          return own;
+        }
+        return rules;
+      }
+      
+      /// Returns false if a restriction was given which the flag cannot hold.
+      bool usable() const {
+        return !misdeclared;
+      }
+      
+      /// Returns whether the given arguments place any restriction on values.
+      static bool any(const CtorArgs &args) {
+        return args._bounded || !args._allowed.empty()
+            || !args._pattern.empty() || args._checkAsync
+            || args._pathChecks;
+      }
+      
+      /**
+       * Starts the check given to checkAsync(), if any, on each of the given
+       * values, which have been accepted, and queues any paths to be checked
+       * once parsing ends. They are numbered as by check().
+       */
+      void startChecks(ArgReader &argReader, const string_view *raw,
+                       size_t count, const string &flag,
+                       size_t firstNumber = 0) const {
+        if (std::is_same<P, Path>::value && pathChecks) {
+          PathChecks &paths = argReader.pathChecks();
+          for (size_t i = 0; i < count; ++i) {
+            paths.add(raw[i], flag, firstNumber ? firstNumber + i : 0,
+                      pathChecks);
+          }
+        }
+        if (asyncCheck) {
+          CheckPool &pool = argReader.checkPool();
+          for (size_t i = 0; i < count; ++i) {
+            pool.submit(asyncCheck, raw[i], flag,
+                        firstNumber ? firstNumber + i : 0);
+          }
+        }
+      }
+      
+      /**
+       * Checks the given values, converted from the given text, printing an
+       * error for the first which is not accepted.
+       * @return the index of the first value not accepted, or `count`
+       */
+      size_t check(const string_view *raw, const P *values, size_t count,
+                   const string &flag, size_t firstNumber = 0) const {
+        if (count && misdeclared) {
+          reportMisdeclared(flag);
+          return 0;
+        }
+        size_t bad = count;
+        if constexpr (ordered) {
+          if (bounded) {
+            bad = firstOutOfRange(values, bad);
+          }
+          if (!allowed.empty()) {
+            for (size_t i = 0; i < bad; ++i) {
+              if (!isAllowed(values[i])) {
+                bad = i;
+              }
+            }
+          }
+        }
+        if (patterned) {
+          for (size_t i = 0; i < bad; ++i) {
+            if (!matchesPattern(raw[i])) {
+              bad = i;
+            }
+          }
+        }
+        if (bad != count) {
+          report(raw[bad], values[bad], flag, firstNumber ? firstNumber + bad
+                                                          : 0);
+        }
+        return bad;
+      }
+      
+      /**
+       * Prints why the given value was not accepted. Values in a list are
+       * numbered from one; zero means the value stands alone.
+       */
+      void report(string_view raw, const P &value, const string &flag,
+                  size_t number) const {
+        char position[32] = "";
+        if (number) {
+          snprintf(position, sizeof(position), " (value #%zu)", number);
+        }
+        string reason;
+        if constexpr (ordered) {
+          if (bounded && !inRange(value)) {
+            reason = "must be between " + minText + " and " + maxText;
+          } else if (!allowed.empty() && !isAllowed(value)) {
+            reason = "must be one of " + allowedText;
+          }
+        }
+        if (reason.empty()) {
+          reason = "must match /" + patternText + "/";
+        }
+        fprintf(stderr, "Invalid value \"%.*s\" for flag %s%s: %s\n",
+            int(raw.length()), raw.data(), flag.c_str(), position,
+            reason.c_str());
+      }
+    };
+    
+    class SingletonFlag: public FlagBase {
+     protected:
+      virtual bool parse(string_view rawvalue) = 0;
+      
+      /**
+       * Checks a value which parsed successfully against any restrictions on
+       * it, printing an error if it is not accepted, and starts any checks
+       * which run alongside parsing.
+       */
+      virtual bool checkValue(ArgReader&, string_view) const {
+        return true;
+      }
+      
+      SingletonFlag(CtorArgs args, unsigned supported):
+          FlagBase(args, supported) {}
+      
+      bool parseArgsR(ArgReader& argReader) final override {
+        string_view raw;
+        if (argReader.hasValue()) {
+          raw = argReader.getValue();
+        } else if (argReader.hasMoreArguments()) {
+          raw = argReader.nextRawArgument();
+        } else {
+          fprintf(stderr, "Flag %s expects a value\n", quotedName().c_str());
+          return false;
+        }
+        if (!parse(raw)) {
+          fprintf(stderr, "Invalid value \"%.*s\" for flag %s\n",
+              int(raw.length()), raw.data(), quotedName().c_str());
+          return false;
+        }
+        if (!checkValue(argReader, raw)) {
+          return false;
+        }
+        argReader.parseNextArg();
+        return true;
+      }
+    };
+    
+    /**
+     * A flag which takes runs of values, handling each as it is read. It may
+     * be given more than once, and its values may be split with splitOn().
+     */
+    class ValueRunFlag: public FlagBase {
+     protected:
+      /// Splits each raw value into several, unless zero.
+      const char delimiter;
+      
+      ValueRunFlag(CtorArgs args, unsigned supported = 0):
+          FlagBase(args, kSplitOn | supported), delimiter(args._delimiter) {}
+      
+      bool atCapacity() const final override {
+        return false;
+      }
+      
+      bool hasFlag(string_view name) const final override {
+        return hasLongName() && getLongName() == name;
+      }
+      
+      bool hasFlag(char name) const final override {
+        return hasShortName() && getShortName() == name;
+      }
+      
+      void printHelp(HelpPrinter &printer) const override {
+        printer.enterFlag(makeProps(true, true, delimiter));
+        if (hasDescription()) {
+          printer.writeBlock(getDescription());
+        }
+        printer.leaveFlag();
+      }
+      
+     public:
+      /// Whether any value has been accepted.
+      bool present = false;
+    };
+    
+    template<typename P> class PrimitiveFlag: public SingletonFlag {
+      /// Restrictions on our value, if any were given.
+      std::shared_ptr<const ValueRules<P>> rules;
+      
+     public:
+      bool present = false;
+      P value = P();
+      
+     protected:
+      PrimitiveFlag(CtorArgs args):
+          SingletonFlag(args, ValueRules<P>::kOptions) {
+        if (ValueRules<P>::any(args)) {
+          rules = valueRules<P>(args);
+        }
+      }
+      
+      bool checkValue(ArgReader &argReader, string_view raw) const override {
+        if (!rules) {
+          return true;
+        }
+        if (rules->check(&raw, &value, 1, quotedName()) != 1) {
+          return false;
+        }
+        rules->startChecks(argReader, &raw, 1, quotedName());
+        return true;
+      }
+      
+      bool atCapacity() const override {
+        return present;
+      }
+      
+      bool hasFlag(string_view name) const override {
+        return hasLongName() && getLongName() == name;
+      }
+      
+      bool hasFlag(char name) const override {
+        return hasShortName() && getShortName() == name;
+      }
+      
+     public:
+      void reset() override {
+        present = false;
+        value = P();
+      }
+      
+      bool parse(string_view rawvalue) override {
+        ParseType<P> parsed(rawvalue);
+        if (parsed.error) {
+          return false;
+        }
+        value = parsed.value;
+        present = true;
+        return true;
+      }
+    };
+    
+    /// Wrapper to std::is_base_of to make other code bits more legible.
+    template<typename T> constexpr bool isFlag() {
       return std::is_base_of<FlagBase, T>::value;
     }
     
     /**
-     * The purpose of this function is to trick the compiler into waiting to
-     * evaluate a static_assert until the class is instantiated. Only then will
-     * the assertion fail and an understandable compile error be raised.
+     * The purpose of this function is to trick the compiler into waiting to
+     * evaluate a static_assert until the class is instantiated. Only then will
+     * the assertion fail and an understandable compile error be raised.
+     */
+    template<typename T> constexpr bool assertionConvolution() {
+      return false;
+    }
+  } // namespace Internal
+
+  namespace Internal {
+    /// The flag for a type with no specialization of its own.
+    template<typename T, bool isEnum = std::is_enum<T>::value>
+    class DefaultFlag {
+      static_assert(assertionConvolution<T>(),
+          "Attempted to instantiate Flag with unsupported type");
+    };
+    
+    /// Enums are given by name, and list their names in help text.
+    template<typename E> class DefaultFlag<E, true>: public PrimitiveFlag<E> {
+      static CtorArgs named(CtorArgs args) {
+        if (args._valuename.empty()) {
+          args._valuename = EnumIndex<E>::listNames();
+        }
+        return args;
+      }
+      
+     protected:
+      DefaultFlag(CtorArgs args): PrimitiveFlag<E>(named(args)) {}
+    };
+  }
+  
+  /// Generic flag class; instantuate with a type to use.
+  template<typename T, bool b = Internal::isFlag<T>()> class Flag:
+      public Internal::DefaultFlag<T> {
+   public:
+    Flag(Internal::CtorArgs args): Internal::DefaultFlag<T>(args) {}
+  };
+  
+  /** Specialization of Flag<T> for when T is also a Flag<> */
+  template<typename T, bool b> class Flag<Flag<T, false>, b>:
+      public Internal::FlagBase {
+    Flag<T> parser;
+    
+   protected:
+    bool parseArgsR(Internal::ArgReader &argReader) final override {
+      return parser.parseArgsR(argReader);
+    }
+     
+   public:
+    T &value = parser.value;
+  };
+  
+  /// Specialization of Flag<T> for when T is any other kind of Flag (FlagBase)
+  template<typename T> class Flag<T, true>: public Internal::FlagBase {
+    using FlagBase::parseArgsR;
+   protected:
+    bool atCapacity() const override {
+      return pAtCapacity(value);
+    }
+    
+    bool hasFlag(std::string_view name) const override {
+      return (hasLongName() && getLongName() == name) || pHasFlag(value, name);
+    }
+    
+    bool hasFlag(char name) const override {
+      return (hasShortName() && getShortName() == name)
+          || pHasFlag(value, name);
+    }
+    
+    bool parseArgsR(Internal::ArgReader &argReader) final override {
+      return invokeParse(&value, argReader);
+    }
+    
+    bool validate() const override {
+      return pValidate(value);
+    }
+    
+    void printHelp(HelpPrinter &printer) const final override {
+      printHelpR(&value, printer);
+    }
+    
+   public:
+    T value;
+    
+    void reset() override {
+      value.reset();
+    }
+     
+    // Only this wrapper joins the enclosing group; it forwards to the value.
+    Flag(CtorArgs args): FlagBase(args), value(ungrouped(args)) {}
+    
+   private:
+    CtorArgs ungrouped(CtorArgs args) {
+      args._declaration = declarationOf(args);
+      args._group = nullptr;
+      args.dropOptions();
+      return args;
+    }
+  };
+
+  class Switch: public Internal::FlagBase {
+    bool parseArgsR(Internal::ArgReader &argReader) final override {
+      if (argReader.hasValue()) {
+        fprintf(stderr, "Flag %s is a switch and cannot accept a value\n",
+            argReader.quotedFlagName().c_str());
+        return false;
+      }
+      present = true;
+      argReader.parseNextArg();
+      return true;
+    }
+    
+    bool atCapacity() const final override {
+      return present;
+    }
+    
+    bool hasFlag(std::string_view name) const final override {
+      return hasLongName() && getLongName() == name;
+    }
+    
+    bool hasFlag(char name) const final override {
+      return hasShortName() && getShortName() == name;
+    }
+    
+   public:
+    bool present = false;
+    Switch(CtorArgs args): FlagBase(args) {}
+    
+    void reset() final override {
+      present = false;
+    }
+  };
+
+# define df_internal_DEFINE_PRIMITIVE_FLAG(T) \
+  template<bool b> class Flag<T, b>: public Internal::PrimitiveFlag<T> { \
+    friend class FlagBase::Instantiator; \
+    \
+   public: \
+    Flag(CtorArgs args): PrimitiveFlag<T>(args) {} \
+  }
+  
+  df_internal_DEFINE_PRIMITIVE_FLAG(bool);
+  df_internal_DEFINE_PRIMITIVE_FLAG(int8_t);
+  df_internal_DEFINE_PRIMITIVE_FLAG(int16_t);
+  df_internal_DEFINE_PRIMITIVE_FLAG(int32_t);
+  df_internal_DEFINE_PRIMITIVE_FLAG(int64_t);
+  df_internal_DEFINE_PRIMITIVE_FLAG(uint8_t);
+  df_internal_DEFINE_PRIMITIVE_FLAG(uint16_t);
+  df_internal_DEFINE_PRIMITIVE_FLAG(uint32_t);
+  df_internal_DEFINE_PRIMITIVE_FLAG(uint64_t);
+  df_internal_DEFINE_PRIMITIVE_FLAG(float);
+  df_internal_DEFINE_PRIMITIVE_FLAG(double);
+  df_internal_DEFINE_PRIMITIVE_FLAG(long double);
+  df_internal_DEFINE_PRIMITIVE_FLAG(std::string);
+  df_internal_DEFINE_PRIMITIVE_FLAG(std::string_view);
+  df_internal_DEFINE_PRIMITIVE_FLAG(Path);
+
+#undef df_internal_DEFINE_PRIMITIVE_FLAG
+
+  /// Has a value only once the flag is given.
+  template<typename T> class Flag<std::optional<T>, false>:
+      public Internal::PrimitiveFlag<std::optional<T>> {
+    typedef Internal::PrimitiveFlag<std::optional<T>> Super;
+    
+   public:
+    Flag(Internal::CtorArgs args): Super(args) {}
+  };
+  
+  /// Holds the first alternative, in order, which accepts the value.
+  template<typename... A> class Flag<std::variant<A...>, false>:
+      public Internal::PrimitiveFlag<std::variant<A...>> {
+    typedef Internal::PrimitiveFlag<std::variant<A...>> Super;
+    
+   public:
+    Flag(Internal::CtorArgs args): Super(args) {}
+  };
+  
+  namespace Internal {
+    /**
+     * Parses a fixed number of values, given as consecutive arguments, into a
+     * tuple-like value such as a std::tuple or std::array. The arity and the
+     * conversion of each element are fixed at compile time, and the raw values
+     * are gathered on the stack, so parsing does not allocate.
+     */
+    template<typename T> class FixedFlag: public FlagBase {
+      static constexpr size_t kArity = std::tuple_size<T>::value;
+      static_assert(kArity > 0, "Fixed-size flags need at least one value");
+      
+      /// Converts one element, printing an error if it is malformed.
+      template<typename E>
+      bool convertElement(string_view raw, E &out, size_t index) const {
+        ParseType<E> parsed(raw);
+        if (parsed.error) {
+          fprintf(stderr, "Invalid value \"%.*s\" for flag %s (value #%zu)\n",
+              int(raw.length()), raw.data(), quotedName().c_str(), index + 1);
+          return false;
+        }
+        out = std::move(parsed.value);
+        return true;
+      }
+      
+      template<size_t... I> bool convertAll(
+          const string_view *raw, T &out, std::index_sequence<I...>) const {
+        return (convertElement(raw[I], std::get<I>(out), I) && ...);
+      }
+      
+     public:
+      bool present = false;
+      T value = T();
+      
+     protected:
+      FixedFlag(CtorArgs args): FlagBase(args) {}
+      
+      bool parseArgsR(ArgReader &argReader) final override {
+        // Values are taken by position, so "-1.5" is a value here, not a flag.
+        string_view raw[kArity];
+        size_t count = 0;
+        if (argReader.hasValue()) {
+          raw[count++] = argReader.getValue();
+        }
+        while (count < kArity && argReader.hasMoreArguments()) {
+          raw[count++] = argReader.nextRawArgument();
+        }
+        if (count < kArity) {
+          fprintf(stderr, "Flag %s expects %zu values, but got %zu\n",
+              quotedName().c_str(), kArity, count);
+          return false;
+        }
+        T parsed;
+        if (!convertAll(raw, parsed, std::make_index_sequence<kArity>())) {
+          return false;
+        }
+        value = std::move(parsed);
+        present = true;
+        argReader.parseNextArg();
+        return true;
+      }
+      
+      bool atCapacity() const final override {
+        return present;
+      }
+      
+      bool hasFlag(string_view name) const final override {
+        return hasLongName() && getLongName() == name;
+      }
+      
+      bool hasFlag(char name) const final override {
+        return hasShortName() && getShortName() == name;
+      }
+      
+     public:
+      void reset() override {
+        present = false;
+        value = T();
+      }
+    };
+  }
+  
+  /// Takes one value for each element of the tuple, such as `--point 1 2`.
+  template<typename... Args> class Flag<std::tuple<Args...>, false>:
+      public Internal::FixedFlag<std::tuple<Args...>> {
+    typedef Internal::FixedFlag<std::tuple<Args...>> Super;
+    
+   public:
+    Flag(Internal::CtorArgs args): Super(args) {}
+  };
+  
+  /// Takes exactly N values, such as `--rgb 255 128 0`.
+  template<typename T, size_t N> class Flag<std::array<T, N>, false>:
+      public Internal::FixedFlag<std::array<T, N>> {
+    typedef Internal::FixedFlag<std::array<T, N>> Super;
+    
+   public:
+    Flag(Internal::CtorArgs args): Super(args) {}
+  };
+  
+  class InternedString;
+  
+  template<typename T, bool greedy, bool reentrant> class VectorFlag:
+      public Internal::FlagBase {
+    bool entered = false;
+    
+    /// Splits each raw value into several elements, unless zero.
+    const char delimiter;
+    
+    /// Whether our elements are plain values, rather than structured flags.
+    static constexpr bool valueElements =
+        std::is_base_of<Internal::SingletonFlag, Flag<T>>::value;
+    
+    // Elements are parsed by temporary flags, which hold the intern table.
+    static_assert(!std::is_same<T, InternedString>::value,
+        "Lists of interned strings are not supported; use a StringList");
+    
+    /// Raw values gathered by parseValues(), pending conversion.
+    std::vector<std::string_view> pending;
+    
+    /// Restrictions on our values, if any were given and they are plain.
+    std::shared_ptr<const Internal::ValueRules<T>> rules;
+    
+    /// The record of our declaration, shared with the elements we build.
+    std::shared_ptr<Internal::Declaration> declaration;
+    
+    /// Stack a new parser for our type
+    Flag<T> newFlag() const {
+      CtorArgs args = getCtorArgs(nullptr);
+      args._declaration = declaration;
+      return FlagBase::Instantiator::instantiate<Flag<T>>(args);
+    }
+    
+    /// Stack a new help printer for our type
+    Flag<T> newAnonymousFlag() const {
+      return FlagBase::Instantiator::instantiate<Flag<T>>(CtorArgs());
+    }
+    
+    /**
+     * Shared anonymous instance of our type, used to answer which names an
+     * element accepts without constructing a new element for every query.
+     */
+    static const Flag<T> &prototype() {
+      static const Flag<T> proto =
+          FlagBase::Instantiator::instantiate<Flag<T>>(CtorArgs());
+      return proto;
+    }
+    
+    static bool canReenter(
+        const Internal::ArgReader &argReader, const FlagBase& flag) {
+      if (!reentrant) {
+        return false;
+      }
+      return argReader.hasShortFlag()
+          ? pHasFlag(flag, argReader.getShortFlag())
+          : pHasFlag(flag, argReader.getLongFlag());
+    }
+    
+   protected:
+    bool atCapacity() const final override {
+      return entered && !reentrant;
+    }
+    
+    bool hasFlag(std::string_view name) const final override {
+      return (hasLongName() && getLongName() == name)
+          || pHasFlag(prototype(), name);
+    }
+    
+    bool hasFlag(char name) const final override {
+      return (hasShortName() && getShortName() == name)
+          || pHasFlag(prototype(), name);
+    }
+    
+    void printHelp(HelpPrinter &printer) const override {
+      printer.enterFlag(makeProps(greedy, reentrant, delimiter));
+      if (hasDescription()) {
+        printer.writeBlock(getDescription());
+      }
+      auto nflag = newAnonymousFlag();
+      printHelpR(&nflag, printer);
+      printer.leaveFlag();
+    }
+    
+    /**
+     * Parses a run of plain values. The raw values are gathered first, in
+     * order, and then converted together, so that long runs can be converted
+     * in parallel. Values are split on the delimiter, if one was given.
+     */
+    bool parseValues(Internal::ArgReader &argReader) {
+      pending.clear();
+      for (;;) {
+        std::string_view raw;
+        if (argReader.hasValue()) {
+          raw = argReader.getValue();
+        } else if (argReader.hasMoreArguments()) {
+          raw = argReader.nextRawArgument();
+        } else {
+          fprintf(stderr, "Flag %s expects a value\n", quotedName().c_str());
+          return false;
+        }
+        if (delimiter) {
+          Internal::splitValue(raw, delimiter, pending);
+        } else {
+          pending.push_back(raw);
+        }
+        argReader.parseNextArg();
+        if (!greedy
+            || (argReader.hasAnyFlag() && !canReenter(argReader, *this))) {
+          break;
+        }
+      }
+      
+      const size_t first = value.size();
+      value.resize(first + pending.size());
+      // The first value which failed to convert, and the first which was
+      // converted but not accepted.
+      size_t bad = pending.size(), rejected = bad;
+      if constexpr (std::is_same<T, bool>::value) {
+        // Packed bits cannot be written concurrently.
+        for (size_t i = 0; i < pending.size() && bad == pending.size()
+             && rejected == pending.size(); ++i) {
+          bool converted;
+          if (!Internal::convertValue(pending[i], converted)) {
+            bad = i;
+          } else if (rules && !rules->check(&pending[i], &converted, 1,
+                                            quotedName(), first + i + 1)) {
+            rejected = i;
+          } else {
+            value[first + i] = converted;
+          }
+        }
+      } else {
+        bad = Internal::convertValues(pending.data(), value.data() + first,
+            pending.size(), Internal::conversionChunks(pending.size()));
+        if (rules) {
+          rejected = rules->check(pending.data(), value.data() + first, bad,
+                                  quotedName(), first + 1);
+          if (rejected == bad) {
+            rejected = pending.size();
+          }
+        }
+      }
+      if (rejected != pending.size()) {
+        value.resize(first + rejected);
+        return false;
+      }
+      if (bad != pending.size()) {
+        value.resize(first + bad);
+        fprintf(stderr, "Invalid value \"%.*s\" for flag %s (value #%zu)\n",
+            int(pending[bad].length()), pending[bad].data(),
+            quotedName().c_str(), first + bad + 1);
+        return false;
+      }
+      if (rules) {
+        rules->startChecks(argReader, pending.data(), pending.size(),
+                           quotedName(), first + 1);
+      }
+      return true;
+    }
+    
+    bool parseArgsR(Internal::ArgReader &argReader) final override {
+      entered = true;
+      if constexpr (valueElements) {
+        return parseValues(argReader);
+      }
+      // Iterate rather than recurse: greedy flags may be given arbitrarily
+      // many values, and each element would otherwise cost a stack frame.
+      for (;;) {
+        Flag<T> flag = newFlag();
+        size_t position = argReader.tell();
+        if (!invokeParse(&flag, argReader)) {
+          return false;
+        }
+        if (position == argReader.tell()) {
+          return true;
+        }
+        // Check elements before moving them into the vector, as a moved
+        // group's members still refer to the original.
+        if (!pValidate(flag)) {
+          return false;
+        }
+        
+        const bool more = greedy
+            && (!argReader.hasAnyFlag() || canReenter(argReader, flag));
+        value.push_back(std::move(flag.value));
+        if (!more) {
+          return true;
+        }
+      }
+    }
+    
+   public:
+    VectorFlag(CtorArgs args):
+        FlagBase(args, valueElements
+            ? Internal::kSplitOn | Internal::ValueRules<T>::kOptions : 0),
+        delimiter(args._delimiter),
+        declaration(declarationOf(args)) {
+      if constexpr (valueElements) {
+        if (Internal::ValueRules<T>::any(args)) {
+          rules = valueRules<T>(args);
+        }
+      }
+    }
+    std::vector<T> value;
+    
+    void reset() final override {
+      entered = false;
+      value.clear();
+    }
+  };
+  
+  template<typename T> class Flag<std::vector<T>, false>:
+      public VectorFlag<T, true, true> {
+    typedef VectorFlag<T, true, true> Super;
+
+   public:
+    Flag(Internal::CtorArgs args): Super(args) {}
+  };
+  
+  template<typename T> class Repeated : public std::vector<T> {};
+  template<typename T> class Sequential : public std::vector<T> {};
+  
+  template<typename T> class Flag<Sequential<T>, false>:
+      public VectorFlag<T, true, false> {
+    typedef VectorFlag<T, true, false> Super;
+
+   public:
+    Flag(Internal::CtorArgs args): Super(args) {}
+  };
+  
+  template<typename T> class Flag<Repeated<T>, false>:
+      public VectorFlag<T, false, true> {
+    typedef VectorFlag<T, false, true> Super;
+
+   public:
+    Flag(Internal::CtorArgs args): Super(args) {}
+  };
+
+  /**
+   * A set of integers stored as sorted, disjoint, inclusive intervals, such
+   * as the shards named by `0-99999,200000-299999`. Membership tests take
+   * logarithmic time in the number of intervals, and iteration visits each
+   * integer in order without materializing the set.
+   */
+  template<typename T> class IntRanges {
+    static_assert(std::is_integral<T>::value && !std::is_same<T, bool>::value,
+        "IntRanges requires an integer type");
+    
+   public:
+    typedef std::pair<T, T> Interval;
+    
+   private:
+    std::vector<Interval> ranges;
+    
+    /// Returns whether an interval ending in `hi` overlaps or abuts `lo`.
+    static bool touches(T hi, T lo) {
+      return lo <= hi || (hi < std::numeric_limits<T>::max() && lo == hi + 1);
+    }
+    
+   public:
+    /// Visits each integer in the set, in increasing order.
+    class const_iterator {
+      const Interval *range = nullptr;
+      const Interval *last = nullptr;
+      T current = T();
+      friend class IntRanges;
+      const_iterator(const Interval *r, const Interval *l, T value):
+          range(r), last(l), current(value) {}
+      
+     public:
+      typedef std::forward_iterator_tag iterator_category;
+      typedef T value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const T *pointer;
+      typedef const T &reference;
+      
+      const_iterator() {}
+      const T &operator*() const { return current; }
+      
+      const_iterator &operator++() {
+        if (current == range->second) {
+          current = ++range == last ? T() : range->first;
+        } else {
+          ++current;
+        }
+        return *this;
+      }
+      const_iterator operator++(int) {
+        const_iterator res = *this;
+        ++*this;
+        return res;
+      }
+      
+      bool operator==(const const_iterator &other) const {
+        return range == other.range && current == other.current;
+      }
+      bool operator!=(const const_iterator &other) const {
+        return !(*this == other);
+      }
+    };
+    
+    /// Adds every integer in [lo, hi], merging with existing intervals.
+    void insert(T lo, T hi) {
+      if (ranges.empty() || !touches(ranges.back().second, lo)) {
+        ranges.emplace_back(lo, hi);
+        return;
+      }
+      // Find the first interval that could merge with [lo, hi].
+      auto first = std::lower_bound(ranges.begin(), ranges.end(), lo,
+          [](const Interval &range, T value) {
+            return !touches(range.second, value);
+          });
+      auto last = first;
+      while (last != ranges.end() && touches(hi, last->first)) {
+        lo = std::min(lo, last->first);
+        hi = std::max(hi, last->second);
+        ++last;
+      }
+      if (first == last) {
+        ranges.insert(first, Interval(lo, hi));
+      } else {
+        *first = Interval(lo, hi);
+        ranges.erase(first + 1, last);
+      }
+    }
+    
+    /// Returns whether the given integer is in this set.
+    bool contains(T value) const {
+      auto it = std::upper_bound(ranges.begin(), ranges.end(), value,
+          [](T v, const Interval &range) { return v < range.first; });
+      return it != ranges.begin() && value <= (it - 1)->second;
+    }
+    
+    /// Returns the number of integers in this set.
+    uint64_t size() const {
+      typedef typename std::make_unsigned<T>::type U;
+      uint64_t res = 0;
+      for (const Interval &range : ranges) {
+        res += uint64_t(U(U(range.second) - U(range.first))) + 1;
+      }
+      return res;
+    }
+    
+    bool empty() const { return ranges.empty(); }
+    void clear() { ranges.clear(); }
+    
+    /// Returns the sorted, disjoint intervals making up this set.
+    const std::vector<Interval> &intervals() const { return ranges; }
+    
+    const_iterator begin() const {
+      const Interval *last = ranges.data() + ranges.size();
+      return ranges.empty() ? end()
+          : const_iterator(ranges.data(), last, ranges.front().first);
+    }
+    const_iterator end() const {
+      const Interval *last = ranges.data() + ranges.size();
+      return const_iterator(last, last, T());
+    }
+    
+    /// Materializes every integer in this set, in order.
+    std::vector<T> toVector() const {
+      std::vector<T> res;
+      res.reserve(size());
+      for (const Interval &range : ranges) {
+        for (T i = range.first; ; ++i) {
+          res.push_back(i);
+          if (i == range.second) {
+            break;
+          }
+        }
+      }
+      return res;
+    }
+  };
+  
+  namespace Internal {
+    /**
+     * Parses a comma-separated list of integers and inclusive ranges, such as
+     * `1,5-9,-3--1`. The endpoints are converted together, like the values of
+     * a list flag.
+     */
+    template<typename T> struct ParseType<IntRanges<T>> {
+      bool error = false;
+      IntRanges<T> value;
+      ParseType(string_view val) {
+        std::vector<string_view> pieces, endpoints;
+        splitValue(val, ',', pieces);
+        endpoints.reserve(2 * pieces.size());
+        for (string_view piece : pieces) {
+          // Skip the first character, which may be the sign of the low end.
+          size_t dash = piece.find('-', 1);
+          if (dash == string_view::npos) {
+            endpoints.push_back(piece);
+            endpoints.push_back(piece);
+          } else {
+            endpoints.push_back(piece.substr(0, dash));
+            endpoints.push_back(piece.substr(dash + 1));
+          }
+        }
+        std::vector<T> bounds(endpoints.size());
+        if (convertValues(endpoints.data(), bounds.data(), endpoints.size(),
+                          conversionChunks(endpoints.size()))
+            != endpoints.size()) {
+          error = true;
+          return;
+        }
+        for (size_t i = 0; i < bounds.size(); i += 2) {
+          if (bounds[i] > bounds[i + 1]) {
+            error = true;
+            return;
+          }
+          value.insert(bounds[i], bounds[i + 1]);
+        }
+      }
+    };
+  }
+  
+  template<typename T> class Flag<IntRanges<T>, false>:
+      public Internal::PrimitiveFlag<IntRanges<T>> {
+    typedef Internal::PrimitiveFlag<IntRanges<T>> Super;
+
+   public:
+    Flag(Internal::CtorArgs args): Super(args) {}
+  };
+
+  /**
+   * A set of enumerators, stored as one bit per enumerator value, so that
+   * testing it against a mask is a bitwise AND. The enum must be named by
+   * EnumNames, with values which are small and not negative.
+   */
+  template<typename E> class EnumSet {
+    static constexpr size_t kBits = Internal::EnumIndex<E>::bitCount();
+    static_assert(kBits > 0 && kBits <= 4096,
+        "EnumSet requires enumerators from 0 to 4095");
+    static constexpr size_t kWords = (kBits + 63) / 64;
+    
+    std::array<uint64_t, kWords> bits {};
+    
+    static constexpr size_t bitOf(E value) {
+      return size_t(std::underlying_type_t<E>(value));
+    }
+    
+   public:
+    constexpr EnumSet() {}
+    constexpr EnumSet(std::initializer_list<E> values) {
+      for (E value : values) {
+        insert(value);
+      }
+    }
+    
+    constexpr void insert(E value) {
+      bits[bitOf(value) / 64] |= uint64_t(1) << bitOf(value) % 64;
+    }
+    constexpr void erase(E value) {
+      bits[bitOf(value) / 64] &= ~(uint64_t(1) << bitOf(value) % 64);
+    }
+    constexpr bool contains(E value) const {
+      return bits[bitOf(value) / 64] >> bitOf(value) % 64 & 1;
+    }
+    
+    /// Returns whether every enumerator in the mask is in this set.
+    constexpr bool containsAll(const EnumSet &mask) const {
+      uint64_t missing = 0;
+      for (size_t i = 0; i < kWords; ++i) {
+        missing |= mask.bits[i] & ~bits[i];
+      }
+      return !missing;
+    }
+    
+    /// Returns whether any enumerator in the mask is in this set.
+    constexpr bool intersects(const EnumSet &mask) const {
+      uint64_t common = 0;
+      for (size_t i = 0; i < kWords; ++i) {
+        common |= mask.bits[i] & bits[i];
+      }
+      return common;
+    }
+    
+    /// Returns the number of enumerators in this set.
+    size_t size() const {
+      size_t res = 0;
+      for (uint64_t word : bits) {
+        res += std::bitset<64>(word).count();
+      }
+      return res;
+    }
+    
+    constexpr bool empty() const { return !intersects(~EnumSet()); }
+    constexpr void clear() { bits = {}; }
+    
+    /// Returns the given 64 bits of this set; bit n stands for value n.
+    constexpr uint64_t word(size_t index) const { return bits[index]; }
+    static constexpr size_t wordCount() { return kWords; }
+    
+    constexpr EnumSet operator~() const {
+      EnumSet res;
+      for (size_t i = 0; i < kWords; ++i) {
+        res.bits[i] = ~bits[i];
+      }
+      if (kBits % 64) {
+        res.bits[kWords - 1] &= (uint64_t(1) << kBits % 64) - 1;
+      }
+      return res;
+    }
+    constexpr EnumSet operator|(const EnumSet &other) const {
+      EnumSet res;
+      for (size_t i = 0; i < kWords; ++i) {
+        res.bits[i] = bits[i] | other.bits[i];
+      }
+      return res;
+    }
+    constexpr EnumSet operator&(const EnumSet &other) const {
+      EnumSet res;
+      for (size_t i = 0; i < kWords; ++i) {
+        res.bits[i] = bits[i] & other.bits[i];
+      }
+      return res;
+    }
+    constexpr bool operator==(const EnumSet &other) const {
+      for (size_t i = 0; i < kWords; ++i) {
+        if (bits[i] != other.bits[i]) {
+          return false;
+        }
+      }
+      return true;
+    }
+    constexpr bool operator!=(const EnumSet &other) const {
+      return !(*this == other);
+    }
+  };
+  
+  /**
+   * Takes a run of enumerator names, such as `--features avx2 sse4`, setting
+   * the bit of each as it is read. The flag may be given more than once, and
+   * its values may be split with splitOn().
+   */
+  template<typename E> class Flag<EnumSet<E>, false>:
+      public Internal::ValueRunFlag {
+    static Internal::CtorArgs named(Internal::CtorArgs args) {
+      if (args._valuename.empty()) {
+        args._valuename = Internal::EnumIndex<E>::listNames();
+      }
+      return args;
+    }
+    
+    bool insertName(std::string_view name) {
+      E parsed;
+      if (!Internal::EnumIndex<E>::lookup(name, parsed)) {
+        fprintf(stderr, "Invalid value \"%.*s\" for flag %s\n",
+            int(name.length()), name.data(), quotedName().c_str());
+        return false;
+      }
+      value.insert(parsed);
+      present = true;
+      return true;
+    }
+    
+   protected:
+    bool parseArgsR(Internal::ArgReader &argReader) final override {
+      return Internal::forEachValue(argReader, *this, delimiter,
+          [this](std::string_view name) { return insertName(name); });
+    }
+    
+   public:
+    EnumSet<E> value;
+    
+    void reset() override {
+      present = false;
+      value.clear();
+    }
+    
+    Flag(Internal::CtorArgs args): ValueRunFlag(named(args)) {}
+  };
+  
+  template<typename K, typename V> class FlatMap;
+  
+  namespace Internal {
+    /**
+     * Parses runs of `key=value` pairs into a map, splitting each at its first
+     * '=' and converting both halves with their ParseTypes. The flag may be
+     * given more than once; keys given again are handled according to the
+     * flag's DuplicateKeys policy.
+     */
+    template<typename M> class MapFlag: public ValueRunFlag {
+      typedef typename M::key_type K;
+      typedef typename M::mapped_type V;
+      static constexpr bool flat = std::is_same<M, FlatMap<K, V>>::value;
+      
+      const DuplicateKeys duplicates;
+      
+      static CtorArgs named(CtorArgs args) {
+        if (args._valuename.empty()) {
+          args._valuename = "KEY=VALUE";
+        }
+        return args;
+      }
+      
+      bool insertPair(string_view raw) {
+        const size_t eq = raw.find('=');
+        if (eq == string_view::npos) {
+          fprintf(stderr, "Flag %s expects key=value, but got \"%.*s\"\n",
+              quotedName().c_str(), int(raw.length()), raw.data());
+          return false;
+        }
+        ParseType<K> key(raw.substr(0, eq));
+        ParseType<V> mapped(raw.substr(eq + 1));
+        if (key.error || mapped.error) {
+          fprintf(stderr, "Invalid value \"%.*s\" for flag %s\n",
+              int(raw.length()), raw.data(), quotedName().c_str());
+          return false;
+        }
+        present = true;
+        if constexpr (flat) {
+          // Sorted and checked for duplicates once the run ends.
+          value.entries.emplace_back(std::move(key.value),
+                                     std::move(mapped.value));
+        } else {
+          auto added = value.try_emplace(std::move(key.value),
+                                         std::move(mapped.value));
+          if (!added.second) {
+            if (duplicates == DuplicateKeys::kError) {
+              fprintf(stderr, "Flag %s was given key \"%.*s\" more than "
+                  "once\n", quotedName().c_str(), int(eq), raw.data());
+              return false;
+            }
+            if (duplicates == DuplicateKeys::kLastWins) {
+              added.first->second = std::move(mapped.value);
+            }
+          }
+        }
+        return true;
+      }
+      
+      bool readPairs(ArgReader &argReader) {
+        return forEachValue(argReader, *this, delimiter,
+            [this](string_view raw) { return insertPair(raw); });
+      }
+      
+     protected:
+      bool parseArgsR(ArgReader &argReader) final override {
+        if constexpr (flat) {
+          const size_t first = value.entries.size();
+          const bool read = readPairs(argReader);
+          const size_t repeated = value.settle(first, duplicates);
+          if (read && repeated != value.size()) {
+            if constexpr (std::is_arithmetic<K>::value
+                || std::is_convertible<const K&, string_view>::value) {
+              fprintf(stderr, "Flag %s was given key \"%s\" more than once\n",
+                  quotedName().c_str(),
+                  formatValue(value.entries[repeated].first).c_str());
+            } else {
+              fprintf(stderr, "Flag %s was given a key more than once\n",
+                  quotedName().c_str());
+            }
+            return false;
+          }
+          return read;
+        } else {
+          return readPairs(argReader);
+        }
+      }
+      
+     public:
+      M value;
+      
+      void reset() override {
+        present = false;
+        value.clear();
+      }
+      
+      MapFlag(CtorArgs args): ValueRunFlag(named(args)),
+          duplicates(args._duplicates) {}
+    };
+  }
+  
+  /**
+   * A map kept as one sorted array of pairs, which is smaller and faster to
+   * search than a node-based map, for maps which are read far more often than
+   * they are changed. As a flag, each run of pairs is sorted and merged into
+   * the map as a whole, so it suits pairs given in a few long runs better
+   * than many runs of a single pair.
+   */
+  template<typename K, typename V> class FlatMap {
+   public:
+    typedef K key_type;
+    typedef V mapped_type;
+    typedef std::pair<K, V> value_type;
+    typedef typename std::vector<value_type>::const_iterator const_iterator;
+    
+   private:
+    std::vector<value_type> entries;
+    template<typename M> friend class Internal::MapFlag;
+    
+    static bool keyLess(const value_type &a, const value_type &b) {
+      return a.first < b.first;
+    }
+    
+    /**
+     * Sorts the entries appended since `first` into place, resolving keys
+     * given more than once by the given policy.
+     * @return the index of a key which was given more than once, if that is
+     *         an error, or the number of entries
+     */
+    size_t settle(size_t first, DuplicateKeys duplicates) {
+      if (first == entries.size()) {
+        return entries.size();
+      }
+      // Both steps are stable, so equal keys remain in the order given.
+      std::stable_sort(entries.begin() + first, entries.end(), keyLess);
+      std::inplace_merge(entries.begin(), entries.begin() + first,
+                         entries.end(), keyLess);
+      size_t out = 0;
+      for (size_t i = 0; i < entries.size();) {
+        size_t next = i + 1;
+        while (next < entries.size()
+               && !keyLess(entries[i], entries[next])) {
+          ++next;
+        }
+        if (next - i > 1 && duplicates == DuplicateKeys::kError) {
+          return i;
+        }
+        const size_t keep =
+            duplicates == DuplicateKeys::kLastWins ? next - 1 : i;
+        if (out != keep) {
+          entries[out] = std::move(entries[keep]);
+        }
+        ++out;
+        i = next;
+      }
+      entries.resize(out);
+      return entries.size();
+    }
+    
+   public:
+    /// Returns the entry with the given key, or end() if there is none.
+    template<typename Q> const_iterator find(const Q &key) const {
+      auto it = std::lower_bound(entries.begin(), entries.end(), key,
+          [](const value_type &entry, const Q &k) { return entry.first < k; });
+      return it != entries.end() && !(key < it->first) ? it : entries.end();
+    }
+    
+    template<typename Q> bool contains(const Q &key) const {
+      return find(key) != end();
+    }
+    
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    void clear() { entries.clear(); }
+    
+    const_iterator begin() const { return entries.begin(); }
+    const_iterator end() const { return entries.end(); }
+  };
+  
+  template<typename K, typename V, typename C, typename A>
+  class Flag<std::map<K, V, C, A>, false>:
+      public Internal::MapFlag<std::map<K, V, C, A>> {
+    typedef Internal::MapFlag<std::map<K, V, C, A>> Super;
+    
+   public:
+    Flag(Internal::CtorArgs args): Super(args) {}
+  };
+  
+  template<typename K, typename V, typename H, typename E, typename A>
+  class Flag<std::unordered_map<K, V, H, E, A>, false>:
+      public Internal::MapFlag<std::unordered_map<K, V, H, E, A>> {
+    typedef Internal::MapFlag<std::unordered_map<K, V, H, E, A>> Super;
+    
+   public:
+    Flag(Internal::CtorArgs args): Super(args) {}
+  };
+  
+  template<typename K, typename V> class Flag<FlatMap<K, V>, false>:
+      public Internal::MapFlag<FlatMap<K, V>> {
+    typedef Internal::MapFlag<FlatMap<K, V>> Super;
+    
+   public:
+    Flag(Internal::CtorArgs args): Super(args) {}
+  };
+  
+  /**
+   * A list of strings stored end to end in one buffer, each followed by a
+   * NUL, with an array of where each ends. A value costs its characters and
+   * one offset, rather than a string object and an allocation of its own, and
+   * the whole list is released at once.
+   */
+  class StringList {
+    std::string chars;
+    std::vector<size_t> ends;
+    
+   public:
+    /// Visits each string, as a view into the list.
+    class const_iterator {
+      const StringList *list = nullptr;
+      size_t index = 0;
+      friend class StringList;
+      const_iterator(const StringList *l, size_t i): list(l), index(i) {}
+      
+     public:
+      typedef std::random_access_iterator_tag iterator_category;
+      typedef std::string_view value_type;
+      typedef std::ptrdiff_t difference_type;
+      typedef const std::string_view *pointer;
+      typedef std::string_view reference;
+      
+      const_iterator() {}
+      std::string_view operator*() const { return (*list)[index]; }
+      std::string_view operator[](difference_type n) const {
+        return (*list)[index + n];
+      }
+      
+      const_iterator &operator++() { ++index; return *this; }
+      const_iterator &operator--() { --index; return *this; }
+      const_iterator operator++(int) { return const_iterator(list, index++); }
+      const_iterator operator--(int) { return const_iterator(list, index--); }
+      const_iterator &operator+=(difference_type n) {
+        index += n;
+        return *this;
+      }
+      const_iterator &operator-=(difference_type n) {
+        index -= n;
+        return *this;
+      }
+      const_iterator operator+(difference_type n) const {
+        return const_iterator(list, index + n);
+      }
+      const_iterator operator-(difference_type n) const {
+        return const_iterator(list, index - n);
+      }
+      difference_type operator-(const const_iterator &other) const {
+        return difference_type(index) - difference_type(other.index);
+      }
+      
+      bool operator==(const_iterator o) const { return index == o.index; }
+      bool operator!=(const_iterator o) const { return index != o.index; }
+      bool operator<(const_iterator o) const { return index < o.index; }
+      bool operator>(const_iterator o) const { return index > o.index; }
+      bool operator<=(const_iterator o) const { return index <= o.index; }
+      bool operator>=(const_iterator o) const { return index >= o.index; }
+    };
+    
+    void push_back(std::string_view text) {
+      chars.append(text.data(), text.length());
+      chars.push_back('\0');
+      ends.push_back(chars.length() - 1);
+    }
+    
+    /// Makes room for the given number of strings and characters in total.
+    void reserve(size_t count, size_t characters) {
+      ends.reserve(count);
+      chars.reserve(characters + count);
+    }
+    
+    std::string_view operator[](size_t index) const {
+      const size_t begin = index ? ends[index - 1] + 1 : 0;
+      return std::string_view(chars.data() + begin, ends[index] - begin);
+    }
+    
+    /// Returns the given string, terminated by a NUL.
+    const char *c_str(size_t index) const {
+      return chars.data() + (index ? ends[index - 1] + 1 : 0);
+    }
+    
+    std::string_view front() const { return (*this)[0]; }
+    std::string_view back() const { return (*this)[ends.size() - 1]; }
+    
+    size_t size() const { return ends.size(); }
+    bool empty() const { return ends.empty(); }
+    
+    /// Returns the number of characters stored, including terminators.
+    size_t characters() const { return chars.length(); }
+    
+    void clear() {
+      chars.clear();
+      ends.clear();
+    }
+    
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, ends.size()); }
+    
+    bool operator==(const StringList &other) const {
+      return ends == other.ends && chars == other.chars;
+    }
+    bool operator!=(const StringList &other) const {
+      return !(*this == other);
+    }
+  };
+  
+  /**
+   * Takes a run of strings into one StringList. The flag may be given more
+   * than once, and its values may be split with splitOn() or checked with
+   * matches().
+   */
+  template<> class Flag<StringList, false>: public Internal::ValueRunFlag {
+    /// Restrictions on our values, if any were given.
+    std::shared_ptr<const Internal::ValueRules<std::string_view>> rules;
+    
+   protected:
+    bool parseArgsR(Internal::ArgReader &argReader) final override {
+      size_t number = value.size();
+      return Internal::forEachValue(argReader, *this, delimiter,
+          [this, &argReader, &number](std::string_view raw) {
+            if (rules) {
+              if (!rules->check(&raw, &raw, 1, quotedName(), ++number)) {
+                return false;
+              }
+              rules->startChecks(argReader, &raw, 1, quotedName(), number);
+            }
+            value.push_back(raw);
+            present = true;
+            return true;
+          });
+    }
+    
+   public:
+    StringList value;
+    
+    void reset() override {
+      present = false;
+      value.clear();
+    }
+    
+    Flag(Internal::CtorArgs args):
+        ValueRunFlag(args, Internal::ValueRules<std::string_view>::kOptions) {
+      if (Internal::ValueRules<std::string_view>::any(args)) {
+        rules = valueRules<std::string_view>(args);
+      }
+    }
+  };
+  
+  /**
+   * Names a flag whose values are handed, one at a time, to a handler as they
+   * are parsed, and are never stored. See `Flag<Stream<T>>`.
+   */
+  template<typename T> class Stream {};
+  
+  /**
+   * Converts each value given and passes it to the handler set with
+   * onValue(), keeping only a count. Memory use does not grow with the number
+   * of values, and the handler may begin work on early values while later
+   * ones are still being read, as with an IncrementalParser. The flag may be
+   * given more than once, and its values may be split with splitOn().
+   */
+  template<typename T> class Flag<Stream<T>, false>:
+      public Internal::ValueRunFlag {
+    /// Receives each value; parsing stops if it returns false.
+    std::function<bool(const T&)> handler;
+    
+    /// Restrictions on our values, if any were given.
+    std::shared_ptr<const Internal::ValueRules<T>> rules;
+    
+   protected:
+    bool parseArgsR(Internal::ArgReader &argReader) final override {
+      return Internal::forEachValue(argReader, *this, delimiter,
+          [this, &argReader](std::string_view raw) {
+            T converted;
+            if (!Internal::convertValue(raw, converted)) {
+              return reject(raw);
+            }
+            if (rules) {
+              if (!rules->check(&raw, &converted, 1, quotedName(),
+                                count + 1)) {
+                return false;
+              }
+              rules->startChecks(argReader, &raw, 1, quotedName(), count + 1);
+            }
+            if (handler && !handler(converted)) {
+              return reject(raw);
+            }
+            ++count;
+            present = true;
+            return true;
+          });
+    }
+    
+    /// Reports the given value, which was not accepted, and returns false.
+    bool reject(std::string_view raw) const {
+      fprintf(stderr, "Invalid value \"%.*s\" for flag %s (value #%zu)\n",
+          int(raw.length()), raw.data(), quotedName().c_str(), count + 1);
+      return false;
+    }
+    
+   public:
+    /// The number of values accepted so far.
+    size_t count = 0;
+    
+    /**
+     * Sets the function called with each value as it is parsed. It may return
+     * nothing, or a bool, in which case returning false rejects the value and
+     * ends parsing with an error.
+     * 
+     * Under an IncrementalParser the handler runs on the parser's stack, so
+     * deep recursion is bounded by the size the parser was given. Anything it
+     * throws stops the parser and is rethrown from feed() or finish().
+     */
+    template<typename Fn> void onValue(Fn fn) {
+      if constexpr (std::is_void<decltype(fn(std::declval<const T&>()))>()) {
+        handler = [fn](const T &value) mutable {
+          fn(value);
+          return true;
+        };
+      } else {
+        handler = std::move(fn);
+      }
+    }
+    
+    /// Forgets the values counted; the handler is kept.
+    void reset() override {
+      present = false;
+      count = 0;
+    }
+    
+    Flag(Internal::CtorArgs args):
+        ValueRunFlag(args, Internal::ValueRules<T>::kOptions) {
+      if (Internal::ValueRules<T>::any(args)) {
+        rules = valueRules<T>(args);
+      }
+    }
+  };
+  
+  /**
+   * A string kept in the intern table of the parse which read it, so that
+   * every equal value from that parse refers to the same copy. Equality is a
+   * comparison of addresses, and so holds only between values from the same
+   * parse. A default-constructed value, for a flag not given, is equal to no
+   * value which was given.
+   */
+  class InternedString {
+    std::string_view text;
+    friend class Flag<InternedString, false>;
+    explicit InternedString(std::string_view stored): text(stored) {}
+    
+   public:
+    InternedString() {}
+    
+    std::string_view view() const { return text; }
+    operator std::string_view() const { return text; }
+    
+    /// Returns the string, terminated by a NUL.
+    const char *c_str() const { return text.data() ? text.data() : ""; }
+    
+    size_t size() const { return text.size(); }
+    bool empty() const { return text.empty(); }
+    
+    bool operator==(InternedString o) const {
+      return text.data() == o.text.data();
+    }
+    bool operator!=(InternedString o) const {
+      return text.data() != o.text.data();
+    }
+  };
+  
+  /**
+   * Takes one string, interned in the table of the parse which reads it. A
+   * value repeated across many groups, such as a label, is then stored once,
+   * and its copies compare as quickly as pointers.
+   */
+  template<> class Flag<InternedString, false>: public Internal::FlagBase {
+    /// Restrictions on our value, if any were given.
+    std::shared_ptr<const Internal::ValueRules<std::string_view>> rules;
+    
+    /// Keeps the string our value refers to alive.
+    std::shared_ptr<const Internal::InternTable> table;
+    
+   protected:
+    bool parseArgsR(Internal::ArgReader &argReader) final override {
+      std::string_view raw;
+      if (argReader.hasValue()) {
+        raw = argReader.getValue();
+      } else if (argReader.hasMoreArguments()) {
+        raw = argReader.nextRawArgument();
+      } else {
+        fprintf(stderr, "Flag %s expects a value\n", quotedName().c_str());
+        return false;
+      }
+      if (rules) {
+        if (rules->check(&raw, &raw, 1, quotedName()) != 1) {
+          return false;
+        }
+        rules->startChecks(argReader, &raw, 1, quotedName());
+      }
+      const std::shared_ptr<Internal::InternTable> &strings =
+          argReader.internTable();
+      if (table != strings) {
+        table = strings;
+      }
+      value = InternedString(strings->intern(raw));
+      present = true;
+      argReader.parseNextArg();
+      return true;
+    }
+    
+    bool atCapacity() const final override {
+      return present;
+    }
+    
+    bool hasFlag(std::string_view name) const final override {
+      return hasLongName() && getLongName() == name;
+    }
+    
+    bool hasFlag(char name) const final override {
+      return hasShortName() && getShortName() == name;
+    }
+    
+   public:
+    bool present = false;
+    InternedString value;
+    
+    void reset() override {
+      present = false;
+      value = InternedString();
+      table.reset();
+    }
+    
+    Flag(Internal::CtorArgs args):
+        FlagBase(args, Internal::ValueRules<std::string_view>::kOptions) {
+      if (Internal::ValueRules<std::string_view>::any(args)) {
+        rules = valueRules<std::string_view>(args);
+      }
+    }
+  };
+  
+  class FlagGroup: public Internal::FlagBase {
+    friend class MultiParser;
+    friend class Internal::FlagBase;
+    
+    std::vector<Internal::FlagBase*> members;
+    std::map<std::string, size_t, std::less<>> membersByLongName;
+    std::map<char, size_t> membersByShortName;
+    
+    /// The record of our declaration, holding one for each member.
+    std::shared_ptr<Internal::Declaration> declaration;
+    
+    /**
+     * The number of members which can still receive a value. This is kept up
+     * to date as this group dispatches to its members, so that atCapacity()
+     * need not poll every member. It is negative until first counted, since
+     * members cannot be asked about their capacity while under construction.
+     */
+    mutable long unsaturatedMembers = -1;
+    
+    /// Counts unsaturated members, if not done since the last change in them.
+    void countUnsaturatedMembers() const {
+      if (unsaturatedMembers < 0) {
+        unsaturatedMembers = 0;
+        for (const Internal::FlagBase *flag : members) {
+          if (!pAtCapacity(*flag)) {
+            ++unsaturatedMembers;
+          }
+        }
+      }
+    }
+    
+    typedef Internal::MemberBits MemberBits;
+    typedef Internal::ConstraintKind ConstraintKind;
+    typedef Internal::Constraint Constraint;
+    
+    /// The members which have been parsed.
+    MemberBits presence;
+    
+    /// How many constraints this instance has added.
+    size_t constraintsAdded = 0;
+    
+    /**
+     * Returns the index of the given member, or, if it is not one, reports
+     * that and marks this group misdeclared.
+     */
+    size_t indexOf(const Internal::FlagBase &flag) {
+      // Members are usually named just after they are added.
+      if (!members.empty() && members.back() == &flag) {
+        return members.size() - 1;
+      }
+      for (size_t i = 0; i < members.size(); ++i) {
+        if (members[i] == &flag) {
+          return i;
+        }
+      }
+      fprintf(stderr, "Internal error: constraint names %s, which is not a "
+          "member of this group\n", flag.quotedName().c_str());
+      declaration->misdeclared = true;
+      markMisdeclared();
+      return members.size();
+    }
+    
+    /**
+     * Returns the record of the given member's declaration, shared by that
+     * member of every instance of this group's declaration.
+     */
+    std::shared_ptr<Internal::Declaration> memberDeclaration(
+        const Internal::FlagBase &flag) {
+      const size_t index = indexOf(flag);
+      if (declaration->members.size() <= index) {
+        declaration->members.resize(index + 1);
+      }
+      std::shared_ptr<Internal::Declaration> &member =
+          declaration->members[index];
+      if (!member) {
+        member = std::make_shared<Internal::Declaration>();
+      }
+      return member;
+    }
+    
+    /**
+     * Compiles a constraint into this group's declaration, unless an earlier
+     * instance of it already has; each instance adds the same constraints, in
+     * the same order.
+     */
+    void addConstraint(ConstraintKind kind, const Internal::FlagBase *subject,
+                       std::initializer_list<const Internal::FlagBase*> flags) {
+      if (constraintsAdded++ < declaration->constraints.size()) {
+        if (declaration->misdeclared) {
+          markMisdeclared();
+        }
+        return;
+      }
+      Constraint constraint { kind, subject ? indexOf(*subject) : 0, {} };
+      for (const Internal::FlagBase *flag : flags) {
+        const size_t index = indexOf(*flag);
+        if (index < members.size()) {
+          constraint.flags.set(index);
+        }
+      }
+      declaration->constraints.push_back(std::move(constraint));
+    }
+    
+    /// Returns the names of the flags with the given bits, for errors.
+    std::string listNames(const MemberBits &bits) const {
+      std::string res;
+      for (size_t i = 0; i < members.size(); ++i) {
+        if (bits.test(i)) {
+          res += (res.empty() ? "" : ", ") + members[i]->quotedName();
+        }
+      }
+      return res;
+    }
+    
+    /// Checks one constraint against the presence bits.
+    bool satisfies(const Constraint &constraint) const {
+      const MemberBits &flags = constraint.flags;
+      switch (constraint.kind) {
+        case ConstraintKind::kExclusive: {
+          bool any = false;
+          for (size_t w = 0; w < flags.words(); ++w) {
+            const uint64_t given = flags.word(w) & presence.word(w);
+            if ((given & (given - 1)) || (given && any)) {
+              return false;
+            }
+            any = any || given;
+          }
+          return true;
+        }
+        case ConstraintKind::kAnyOf:
+          for (size_t w = 0; w < flags.words(); ++w) {
+            if (flags.word(w) & presence.word(w)) {
+              return true;
+            }
+          }
+          return false;
+        case ConstraintKind::kDependency:
+          if (!presence.test(constraint.subject)) {
+            return true;
+          }
+          for (size_t w = 0; w < flags.words(); ++w) {
+            if (flags.word(w) & ~presence.word(w)) {
+              return false;
+            }
+          }
+          return true;
+        default:
+          return false;
+      }
+    }
+    
+    /// Prints the error for a constraint which is not satisfied.
+    void reportViolation(const Constraint &constraint) const {
+      switch (constraint.kind) {
+        case ConstraintKind::kExclusive: {
+          MemberBits given;
+          for (size_t i = 0; i < members.size(); ++i) {
+            if (constraint.flags.test(i) && presence.test(i)) {
+              given.set(i);
+            }
+          }
+          fprintf(stderr, "Flags %s cannot be given together\n",
+              listNames(given).c_str());
+          break;
+        }
+        case ConstraintKind::kAnyOf: {
+          const uint64_t low = constraint.flags.word(0);
+          if (constraint.flags.words() == 1 && !(low & (low - 1))) {
+            fprintf(stderr, "Flag %s is required\n",
+                listNames(constraint.flags).c_str());
+          } else {
+            fprintf(stderr, "One of flags %s is required\n",
+                listNames(constraint.flags).c_str());
+          }
+          break;
+        }
+        case ConstraintKind::kDependency:
+          fprintf(stderr, "Flag %s requires %s\n",
+              members[constraint.subject]->quotedName().c_str(),
+              listNames(constraint.flags).c_str());
+          break;
+        default:
+          break;
+      }
+    }
+    
+    /// The indices of positional members, in the order they were added.
+    std::vector<size_t> positionals;
+    
+    /// Arguments left over after "--".
+    ArgSpan remainder;
+    
+    /// Whether unknown flags are collected rather than rejected.
+    bool passingUnknown = false;
+    
+    /// Unknown flags and their values, with adjacent runs merged.
+    std::vector<ArgRange> unknown;
+    
+    /**
+     * Returns the index of the first positional member which can take another
+     * value, or the number of members if there is none.
      */
-    template<typename T> constexpr bool assertionConvolution() {
-      return false;
+    size_t nextPositional() const {
+      for (size_t index : positionals) {
+        if (!pAtCapacity(*members[index])) {
+          return index;
+        }
+      }
+      return members.size();
     }
-  } // namespace Internal
-
-  /// Generic flag class; instantuate with a type to use.
-  template<typename T, bool b = Internal::isFlag<T>()> class Flag {
-    static_assert(Internal::assertionConvolution<T>(),
-        "Attempted to instantiate Flag with unsupported type");
-  };
-  
-  /** Specialization of Flag<T> for when T is also a Flag<> */
-  template<typename T, bool b> class Flag<Flag<T, false>, b>:
-      public Internal::FlagBase {
-    Flag<T> parser;
     
-   protected:
-    bool parseArgsR(Internal::ArgReader &argReader) final override {
-      return parser.parseArgsR(argReader);
+    /// Parses into the given member, which must not be at capacity.
+    bool parseMember(size_t index, Internal::ArgReader &argReader) {
+      Internal::FlagBase *flag = members[index];
+      if (!invokeParse(flag, argReader)) {
+        return false;
+      }
+      presence.set(index);
+      if (pAtCapacity(*flag)) {
+        --unsaturatedMembers;
+      }
+      return true;
     }
-     
-   public:
-    T &value = parser.value;
-  };
-  
-  /// Specialization of Flag<T> for when T is any other kind of Flag (FlagBase)
-  template<typename T> class Flag<T, true>: public Internal::FlagBase {
-    using FlagBase::parseArgsR;
+    
    protected:
-    bool atCapacity() const override {
-      return pAtCapacity(value);
+    bool atCapacity() const final override {
+      countUnsaturatedMembers();
+      return !unsaturatedMembers;
     }
     
-    bool hasFlag(std::string name) const override {
-      return pHasFlag(value, name);
+    bool hasFlag(std::string_view name) const final override {
+      for (size_t i = 0; i < members.size(); ++i) {
+        if (pHasFlag(*members[i], name)) {
+          return true;
+        }
+      }
+      return false;
     }
     
-    bool hasFlag(char name) const override {
-      return pHasFlag(value, name);
+    bool hasFlag(char name) const final override {
+      for (size_t i = 0; i < members.size(); ++i) {
+        if (pHasFlag(*members[i], name)) {
+          return true;
+        }
+      }
+      return false;
     }
     
     bool parseArgsR(Internal::ArgReader &argReader) final override {
-      return invokeParse(&value, argReader);
+      if (argReader.hasLongFlag() && argReader.hasShortFlag()) {
+        fprintf(stderr,
+            "Internal error: concurrently read flags \"%.*s\", '%c'\n",
+            int(argReader.getLongFlag().length()),
+            argReader.getLongFlag().data(), argReader.getShortFlag());
+        return false;
+      }
+      if (!argReader.hasAnyFlag() && !argReader.hasValue()) {
+        fputs("Internal error: flag parser invoked with no data", stderr);
+        return false;
+      }
+      
+      if ((hasLongName() && argReader.hasLongFlag()
+              && getLongName() == argReader.getLongFlag())
+          || (hasShortName() && argReader.hasShortFlag()
+              && getShortName() == argReader.getShortFlag())) {
+        argReader.parseNextArg();
+      }
+      
+      countUnsaturatedMembers();
+      while (!argReader.atEnd()) {
+        if (!argReader.hasAnyFlag()) {
+          // A bare value goes to the first positional member with room.
+          const size_t index = nextPositional();
+          if (index == members.size()) {
+            return true;
+          }
+          unsigned pos = argReader.tell();
+          if (!parseMember(index, argReader)) {
+            return false;
+          }
+          if (argReader.tell() == pos) {
+            return true;
+          }
+        } else if (argReader.hasLongFlag()) {
+          auto flag = membersByLongName.find(argReader.getLongFlag());
+          if (flag == membersByLongName.end()
+              || pAtCapacity(*members[flag->second])) {
+            return true;
+          }
+          unsigned pos = argReader.tell();
+          if (!parseMember(flag->second, argReader)) {
+            return false;
+          }
+          if (argReader.tell() == pos) {
+            return true;
+          }
+        } else {
+          auto flag = membersByShortName.find(argReader.getShortFlag());
+          if (flag == membersByShortName.end()
+              || pAtCapacity(*members[flag->second])) {
+            return true;
+          }
+          if (!parseMember(flag->second, argReader)) {
+            return false;
+          }
+        }
+      }
+      return true;
     }
     
-    void printHelp(HelpPrinter &printer) const final override {
-      printHelpR(&value, printer);
+    bool keepRemaining(ArgSpan args) override {
+      remainder = args;
+      return true;
     }
     
-   public:
-    T value;
-     
-    Flag(CtorArgs args): FlagBase(args), value(args) {}
-  };
-
-  class Switch: public Internal::FlagBase {
-    bool parseArgsR(Internal::ArgReader &argReader) final override {
-      if (argReader.hasValue()) {
-        fprintf(stderr, "Flag %s is a switch and cannot accept a value\n",
-            argReader.quotedFlagName().c_str());
+    bool keepUnknown(Internal::ArgReader &argReader) override {
+      if (!passingUnknown || !argReader.startsArgument()) {
         return false;
       }
-      present = true;
-      argReader.parseNextArg();
+      if (argReader.hasLongFlag() ? hasFlag(argReader.getLongFlag())
+                                  : hasFlag(argReader.getShortFlag())) {
+        return false;
+      }
+      ArgRange skipped = argReader.skipFlag();
+      if (!unknown.empty()
+          && unknown.back().first + unknown.back().count == skipped.first) {
+        unknown.back().count += skipped.count;
+      } else {
+        unknown.push_back(skipped);
+      }
       return true;
     }
     
-    bool atCapacity() const final override {
-      return present;
+    bool validate() const override {
+      for (const Constraint &constraint : declaration->constraints) {
+        if (!satisfies(constraint)) {
+          reportViolation(constraint);
+          return false;
+        }
+      }
+      for (const Internal::FlagBase *flag : members) {
+        if (!pValidate(*flag)) {
+          return false;
+        }
+      }
+      return true;
     }
     
-    bool hasFlag(std::string name) const final override {
-      return getLongName() == name;
+    // ---------------------------------------------------------------
+    // Constraints, checked once parsing has finished
+    // ---------------------------------------------------------------
+    
+    /// Allows at most one of the given members to be given.
+    void mutuallyExclusive(
+        std::initializer_list<const Internal::FlagBase*> flags) {
+      addConstraint(ConstraintKind::kExclusive, nullptr, flags);
     }
     
-    bool hasFlag(char name) const final override {
-      return getShortName() == name;
+    /// Requires at least one of the given members to be given.
+    void requireOneOf(std::initializer_list<const Internal::FlagBase*> flags) {
+      addConstraint(ConstraintKind::kAnyOf, nullptr, flags);
+    }
+    
+    /// Requires each of the given members to be given along with `flag`.
+    void dependsOn(const Internal::FlagBase &flag,
+                   std::initializer_list<const Internal::FlagBase*> flags) {
+      addConstraint(ConstraintKind::kDependency, &flag, flags);
     }
     
+    // ---------------------------------------------------------------
+    
    public:
-    bool present = false;
-    Switch(CtorArgs args): FlagBase(args) {}
+    void addFlag(FlagBase *flag) {
+      const size_t index = members.size();
+      members.push_back(flag);
+      unsaturatedMembers = -1;
+      if (flag->hasLongName()) {
+        membersByLongName[flag->getLongName()] = index;
+      }
+      if (flag->hasShortName()) {
+        membersByShortName[flag->getShortName()] = index;
+      }
+      if (flag->isRequired()) {
+        addConstraint(ConstraintKind::kAnyOf, nullptr, { flag });
+      }
+      if (flag->isPositional()) {
+        positionals.push_back(index);
+      }
+    }
+    
+    /**
+     * Returns the arguments following "--" which no positional flag took, to
+     * be passed on to another program. They point into the parsed argv.
+     */
+    const ArgSpan &remainingArgs() const {
+      return remainder;
+    }
+    
+    /**
+     * Collects flags which no flag in this group accepts, along with the
+     * values following them, rather than failing the parse. Short flags must
+     * each be given as their own argument, since a chain such as "-pz" cannot
+     * be forwarded in part.
+     */
+    void passUnknownFlags() {
+      passingUnknown = true;
+    }
+    
+    /**
+     * Returns the unknown flags collected by passUnknownFlags(), in order, as
+     * ranges of the parsed argv.
+     */
+    const std::vector<ArgRange> &unknownArgs() const {
+      return unknown;
+    }
+    
+    /**
+     * Builds an argv for an inner program out of the parsed one: its program
+     * name, each unknown flag with its values, then "--" and anything left
+     * after it, terminated by a null pointer as execv() expects.
+     */
+    std::vector<const char*> forwardedArgs(const char *const *argv) const {
+      size_t total = 3 + remainder.size();
+      for (const ArgRange &range : unknown) {
+        total += range.count;
+      }
+      std::vector<const char*> res;
+      res.reserve(total);
+      res.push_back(argv[0]);
+      for (const ArgRange &range : unknown) {
+        res.insert(res.end(), argv + range.first,
+                   argv + range.first + range.count);
+      }
+      if (!remainder.empty()) {
+        res.push_back("--");
+        res.insert(res.end(), remainder.begin(), remainder.end());
+      }
+      res.push_back(nullptr);
+      return res;
+    }
+    
+    void reset() override {
+      for (Internal::FlagBase *flag : members) {
+        flag->reset();
+      }
+      presence.clear();
+      remainder = ArgSpan();
+      unknown.clear();
+      unsaturatedMembers = -1;
+    }
+    
+    void printHelp(std::ostream &stream) const {
+      BasicHelpPrinter printer(stream);
+      printHelp(printer);
+    }
+    
+    void printHelp(HelpPrinter &printer) const override {
+      printer.enterFlag(makeProps());
+      for (Internal::FlagBase *flag : members) {
+        printHelpR(flag, printer);
+      }
+      printer.leaveFlag();
+    }
+    
+    FlagGroup(CtorArgs args):
+        FlagBase(args), declaration(declarationOf(args)) {}
+    FlagGroup(): FlagGroup(CtorArgs()) {}
   };
-
-# define df_internal_DEFINE_PRIMITIVE_FLAG(T) \
-  template<bool b> class Flag<T, b>: public Internal::PrimitiveFlag<T> { \
-    friend class FlagBase::Instantiator; \
-    \
-   public: \
-    Flag(CtorArgs args): PrimitiveFlag<T>(args) {} \
+  
+  inline void Internal::FlagBase::addThisTo(FlagGroup *group) {
+    group->addFlag(this);
   }
   
-  df_internal_DEFINE_PRIMITIVE_FLAG(bool);
-  df_internal_DEFINE_PRIMITIVE_FLAG(int8_t);
-  df_internal_DEFINE_PRIMITIVE_FLAG(int16_t);
-  df_internal_DEFINE_PRIMITIVE_FLAG(int32_t);
-  df_internal_DEFINE_PRIMITIVE_FLAG(int64_t);
-  df_internal_DEFINE_PRIMITIVE_FLAG(uint8_t);
-  df_internal_DEFINE_PRIMITIVE_FLAG(uint16_t);
-  df_internal_DEFINE_PRIMITIVE_FLAG(uint32_t);
-  df_internal_DEFINE_PRIMITIVE_FLAG(uint64_t);
-  df_internal_DEFINE_PRIMITIVE_FLAG(float);
-  df_internal_DEFINE_PRIMITIVE_FLAG(double);
-  df_internal_DEFINE_PRIMITIVE_FLAG(long double);
-  df_internal_DEFINE_PRIMITIVE_FLAG(std::string);
-
-#undef df_internal_DEFINE_PRIMITIVE_FLAG
-
-  /*template<typename ... Args>
-      class Flag<std::tuple<Args...>>: public Internal::FlagBase {
-    typedef std::tuple<Args...> ValueTuple;
-    ValueTuple value;
-
-   public:
-    Flag(std::initializer_list<string> names, ValueTuple defaults):
-        Flag(names[0]), value(defaults) {}
-  };*/
+  inline std::shared_ptr<Internal::Declaration>
+      Internal::FlagBase::declarationOf(const CtorArgs &args) {
+    if (args._declaration) {
+      return args._declaration;
+    }
+    if (args._group) {
+      return args._group->memberDeclaration(*this);
+    }
+    return std::make_shared<Declaration>();
+  }
   
+  template<typename P> std::shared_ptr<const Internal::ValueRules<P>>
+      Internal::FlagBase::valueRules(const CtorArgs &args) {
+    auto rules = ValueRules<P>::declared(args, *declarationOf(args),
+                                         quotedName());
+    if (!rules->usable()) {
+      markMisdeclared();
+    }
+    return rules;
+  }
   
-  template<typename T, bool greedy, bool reentrant> class VectorFlag:
-      public Internal::FlagBase {
-    bool entered = false;
+  inline Internal::CtorArgs flag(FlagGroup *group, std::string name) {
+    return Internal::CtorArgs(group, name);
+  }
+  
+  inline Internal::CtorArgs flag(
+      FlagGroup *group, std::string name, char shortname) {
+    return Internal::CtorArgs(group, name, shortname);
+  }
+  
+  inline Internal::CtorArgs flag(FlagGroup *group, char shortname) {
+    return Internal::CtorArgs(group, shortname);
+  }
+  
+  /**
+   * Declares a flag which takes values given without a flag name, in the
+   * order positional flags are declared. A list flag takes every such value
+   * up to the next flag name.
+   */
+  inline Internal::CtorArgs positional(FlagGroup *group, std::string name) {
+    Internal::CtorArgs args(group, char(0));
+    args._positional = true;
+    return args.valueName(name);
+  }
+  
+  /**
+   * Parses one argv into several independent top-level groups, such as one
+   * per library, in a single pass. Each flag is handed to the group which
+   * declares it, along with whatever follows it that the group accepts.
+   * 
+   * Names declared by more than one group are reported when the parser is
+   * built; such a flag goes to the first group given which declares it.
+   */
+  class MultiParser {
+    /// A top-level member, by index of its group and index within it.
+    struct Owner {
+      size_t group;
+      size_t member;
+    };
+    
+    std::vector<FlagGroup*> groups;
+    std::map<std::string, Owner, std::less<>> ownersByLongName;
+    std::map<char, Owner> ownersByShortName;
+    std::vector<std::string> conflicting;
+    ArgSpan remainder;
+    
+    /// Indexes the top-level members of the given group.
+    void index(size_t group) {
+      const FlagGroup &flags = *groups[group];
+      for (const auto &name : flags.membersByLongName) {
+        auto added = ownersByLongName.emplace(
+            name.first, Owner { group, name.second });
+        if (!added.second && added.first->second.group != group) {
+          conflict("\"" + name.first + "\"");
+        }
+      }
+      for (const auto &name : flags.membersByShortName) {
+        auto added = ownersByShortName.emplace(
+            name.first, Owner { group, name.second });
+        if (!added.second && added.first->second.group != group) {
+          conflict(std::string("'") + name.first + "'");
+        }
+      }
+    }
+    
+    void conflict(std::string quotedName) {
+      fprintf(stderr, "Flag %s is declared by more than one group\n",
+              quotedName.c_str());
+      conflicting.push_back(std::move(quotedName));
+    }
+    
+    /**
+     * Returns the group which should take the current argument: the owner of
+     * a flag which can take another value, or the first group with a
+     * positional flag which can.
+     * @return the group's index, or the number of groups if there is none
+     */
+    size_t ownerOf(const Internal::ArgReader &argReader) const {
+      if (!argReader.hasAnyFlag()) {
+        for (size_t i = 0; i < groups.size(); ++i) {
+          if (groups[i]->nextPositional() != groups[i]->members.size()) {
+            return i;
+          }
+        }
+        return groups.size();
+      }
+      const Owner *owner = nullptr;
+      if (argReader.hasLongFlag()) {
+        auto found = ownersByLongName.find(argReader.getLongFlag());
+        if (found != ownersByLongName.end()) {
+          owner = &found->second;
+        }
+      } else {
+        auto found = ownersByShortName.find(argReader.getShortFlag());
+        if (found != ownersByShortName.end()) {
+          owner = &found->second;
+        }
+      }
+      if (!owner || FlagGroup::pAtCapacity(
+            *groups[owner->group]->members[owner->member])) {
+        return groups.size();
+      }
+      return owner->group;
+    }
+    
+    /// Parses the given arguments into the groups, checking constraints.
+    bool parseGroups(Internal::ArgReader &argReader) {
+      argReader.parseNextArg();
+      while (!argReader.atEnd()) {
+        const size_t group = ownerOf(argReader);
+        if (group == groups.size()) {
+          if (argReader.pastOptions() && !argReader.hasAnyFlag()) {
+            remainder = argReader.remaining();
+            break;
+          }
+          argReader.reportUnexpected();
+          return false;
+        }
+        if (!groups[group]->parseArgsR(argReader)) {
+          return false;
+        }
+      }
+      for (const FlagGroup *flags : groups) {
+        if (!flags->validateDeclared()) {
+          return false;
+        }
+      }
+      return true;
+    }
     
-    /// Stack a new parser for our type
-    Flag<T> newFlag() const {
-      return FlagBase::Instantiator::instantiate<Flag<T>>(getCtorArgs(nullptr));
+   public:
+    MultiParser(std::initializer_list<FlagGroup*> flagGroups):
+        groups(flagGroups) {
+      for (size_t i = 0; i < groups.size(); ++i) {
+        index(i);
+      }
     }
     
-    /// Stack a new help printer for our type
-    Flag<T> newAnonymousFlag() const {
-      return FlagBase::Instantiator::instantiate<Flag<T>>(CtorArgs());
+    /// Returns the quoted names declared by more than one group.
+    const std::vector<std::string> &conflicts() const {
+      return conflicting;
     }
     
-    static bool canReenter(
-        const Internal::ArgReader &argReader, const FlagBase& flag) {
-      if (!reentrant) {
-        return false;
-      }
-      return argReader.hasShortFlag()
-          ? pHasFlag(flag, argReader.getShortFlag())
-          : pHasFlag(flag, argReader.getLongFlag());
+    /**
+     * Returns the arguments following "--" which no positional flag took.
+     * They point into the parsed argv.
+     */
+    const ArgSpan &remainingArgs() const {
+      return remainder;
     }
     
-   protected:
-    bool atCapacity() const final override {
-      return entered && !reentrant;
+    /**
+     * Parses the given arguments into the groups, then checks each group's
+     * constraints, and waits for any checks started with checkAsync().
+     * @return true on success, false if any argument was rejected
+     */
+    bool parseArgs(int argc, const char *const *argv) {
+      Internal::ArgReader argReader(argc, argv);
+      const bool parsed = parseGroups(argReader);
+      const bool checked = argReader.finishChecks();
+      return parsed && checked;
     }
     
-    bool hasFlag(std::string name) const final override {
-      return getLongName() == name || pHasFlag(newFlag(), name);
+    /// Resets every group, and forgets any remaining arguments.
+    void reset() {
+      for (FlagGroup *flags : groups) {
+        flags->reset();
+      }
+      remainder = ArgSpan();
     }
     
-    bool hasFlag(char name) const final override {
-      return getShortName() == name || pHasFlag(newFlag(), name);
+    void printHelp(std::ostream &stream) const {
+      for (const FlagGroup *flags : groups) {
+        flags->printHelp(stream);
+      }
     }
+  };
+  
+#ifdef DEEPFLAGS_INCREMENTAL
+  /**
+   * Parses arguments as they arrive, such as tokens read piecemeal from a
+   * pipe. Each call to feed() runs the parser until it needs an argument it
+   * has not been given, then returns; the parser picks up where it stopped on
+   * the next call, even in the middle of a nested group or a run of values.
+   * 
+   * The parser runs on its own stack, which is switched to and from on the
+   * calling thread, so nothing blocks while waiting for input. A guard page
+   * below the stack turns an overflow into a fault rather than corruption.
+   * An exception thrown by a flag stops the parser, and is rethrown from the
+   * feed() or finish() which ran it.
+   */
+  class IncrementalParser: Internal::ArgSource {
+    Internal::FlagBase &flags;
     
-    void printHelp(HelpPrinter &printer) const override {
-      printer.enterFlag(makeProps(greedy, reentrant));
-      if (hasDescription()) {
-        printer.writeBlock(getDescription());
+    /// Every argument received, preceded by an empty program name.
+    std::deque<std::string> tokens;
+    std::vector<const char*> argv;
+    
+    /// The mapping holding the guard page, then the stack above it.
+    char *mapping = nullptr;
+    size_t mappingSize = 0;
+    ucontext_t caller, parser;
+    
+    bool started = false;
+    bool ended = false;
+    bool finished = false;
+    bool success = false;
+    /// What the parser threw, until it is rethrown to the caller.
+    std::exception_ptr thrown;
+    
+    static void run(unsigned high, unsigned low) {
+      IncrementalParser *self = reinterpret_cast<IncrementalParser*>(
+          uintptr_t(uint64_t(high) << 32 | low));
+      // Nothing may unwind past this frame, which has no caller to return to.
+      try {
+        Internal::ArgReader argReader(self->argv.size(), self->argv.data(),
+                                      self);
+        self->success = self->flags.parseArgs(argReader);
+      } catch (...) {
+        self->success = false;
+        self->thrown = std::current_exception();
       }
-      auto nflag = newAnonymousFlag();
-      printHelpR(&nflag, printer);
-      printer.leaveFlag();
+      self->finished = true;
     }
     
-    bool parseArgsR(Internal::ArgReader &argReader) final override {
-      entered = true;
-      Flag<T> flag = newFlag();
-      size_t position = argReader.tell();
-      if (!invokeParse(&flag, argReader)) {
+    /// Maps the stack, with an inaccessible page below it.
+    bool mapStack() {
+      const size_t page = size_t(sysconf(_SC_PAGESIZE));
+      mappingSize = page + (stackSize + page - 1) / page * page;
+      void *mapped = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE,
+                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (mapped == MAP_FAILED) {
         return false;
       }
-      if (position == argReader.tell()) {
-        return true;
-      }
-      
-      value.push_back(flag.value);
-      if (greedy
-          && (!argReader.hasAnyFlag() || canReenter(argReader, flag))) {
-        return parseArgsR(argReader);
+      mapping = static_cast<char*>(mapped);
+      if (mprotect(mapping, page, PROT_NONE) != 0) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        return false;
       }
       return true;
     }
     
+    /// Runs the parser until it next waits for input, or finishes.
+    void resume() {
+      if (!started) {
+        started = true;
+        if (!mapStack()) {
+          fprintf(stderr, "Could not allocate a parser stack of %zu bytes\n",
+                  stackSize);
+          finished = true;
+          return;
+        }
+        const size_t page = size_t(sysconf(_SC_PAGESIZE));
+        getcontext(&parser);
+        parser.uc_stack.ss_sp = mapping + page;
+        parser.uc_stack.ss_size = mappingSize - page;
+        parser.uc_link = &caller;
+        // makecontext only passes int arguments, so split our address.
+        const uint64_t self = uintptr_t(this);
+        makecontext(&parser, reinterpret_cast<void (*)()>(
+                        reinterpret_cast<void*>(&IncrementalParser::run)), 2,
+                    unsigned(self >> 32), unsigned(self));
+      }
+      swapcontext(&caller, &parser);
+      if (thrown) {
+        std::rethrow_exception(std::exchange(thrown, nullptr));
+      }
+    }
+    
+    bool await(unsigned index, unsigned &argc,
+               const char *const *&argvOut) override {
+      while (index >= argv.size() && !ended) {
+        swapcontext(&parser, &caller);
+      }
+      argc = argv.size();
+      argvOut = argv.data();
+      return index < argv.size();
+    }
+    
    public:
-    VectorFlag(CtorArgs args): FlagBase(args) {}
-    std::vector<T> value;
-  };
-  
-  template<typename T> class Flag<std::vector<T>, false>:
-      public VectorFlag<T, true, true> {
-    typedef VectorFlag<T, true, true> Super;
-
-   public:
-    Flag(Internal::CtorArgs args): Super(args) {}
-  };
-  
-  template<typename T> class Repeated : public std::vector<T> {};
-  template<typename T> class Sequential : public std::vector<T> {};
-  
-  template<typename T> class Flag<Sequential<T>, false>:
-      public VectorFlag<T, true, false> {
-    typedef VectorFlag<T, true, false> Super;
-
-   public:
-    Flag(Internal::CtorArgs args): Super(args) {}
-  };
-  
-  template<typename T> class Flag<Repeated<T>, false>:
-      public VectorFlag<T, false, true> {
-    typedef VectorFlag<T, false, true> Super;
-
-   public:
-    Flag(Internal::CtorArgs args): Super(args) {}
-  };
-
-  class FlagGroup: public Internal::FlagBase {
-    std::vector<Internal::FlagBase*> members;
-    std::map<std::string, Internal::FlagBase*> membersByLongName;
-    std::map<char, Internal::FlagBase*> membersByShortName;
+    const size_t stackSize;
     
-   protected:
-    bool atCapacity() const final override {
-      for (size_t i = 0; i < members.size(); ++i) {
-        if (!pAtCapacity(*members[i])) {
-          return false;
-        }
+    /**
+     * Prepares to parse arguments into the given flags, on a stack of the
+     * given size. Each level of nested groups uses a few hundred bytes, but
+     * matches() patterns can recurse once per character of a value. Pages of
+     * the stack are only committed once touched.
+     */
+    explicit IncrementalParser(Internal::FlagBase &flagsToParse,
+                               size_t parserStackSize = 8 * 1024 * 1024):
+        flags(flagsToParse), tokens(1), argv(1, tokens[0].c_str()),
+        stackSize(parserStackSize) {}
+    
+    IncrementalParser(const IncrementalParser&) = delete;
+    IncrementalParser &operator=(const IncrementalParser&) = delete;
+    
+    /**
+     * Ends the input, as by finish(), if the parser is still waiting. Anything
+     * thrown while finishing is discarded.
+     */
+    ~IncrementalParser() override {
+      if (started) {
+        try {
+          finish();
+        } catch (...) {}
+      }
+      if (mapping) {
+        munmap(mapping, mappingSize);
       }
-      return true;
     }
     
-    bool hasFlag(std::string name) const final override {
-      for (size_t i = 0; i < members.size(); ++i) {
-        if (pHasFlag(*members[i], name)) {
-          return true;
-        }
+    /**
+     * Hands the next argument to the parser, then runs it until it needs
+     * another. Arguments given after the parser has finished are ignored.
+     */
+    void feed(std::string argument) {
+      if (finished || ended) {
+        return;
       }
-      return false;
+      tokens.push_back(std::move(argument));
+      argv.push_back(tokens.back().c_str());
+      resume();
     }
     
-    bool hasFlag(char name) const final override {
-      for (size_t i = 0; i < members.size(); ++i) {
-        if (pHasFlag(*members[i], name)) {
+    /**
+     * Signals that no more arguments will arrive, and runs the parser to
+     * completion.
+     * @return true if every argument was parsed successfully
+     */
+    bool finish() {
+      ended = true;
+      if (!finished) {
+        resume();
+      }
+      return success;
+    }
+    
+    /**
+     * Returns whether the parser has stopped, either because the input ended
+     * or because it hit an error.
+     */
+    bool done() const {
+      return finished;
+    }
+    
+    /// Returns whether the parser finished without error.
+    bool succeeded() const {
+      return finished && success;
+    }
+  };
+#endif
+  
+  namespace Internal {
+    /// The characters which interrupt a scan of part of a command line.
+    enum class ScanStop {
+      /// Blanks, quotes, and backslashes, outside of quotes.
+      kWord,
+      /// Closing quotes and backslashes, inside double quotes.
+      kDoubleQuoted,
+      /// Closing quotes, inside single quotes.
+      kSingleQuoted,
+    };
+    
+    inline bool stopsScan(char c, ScanStop stop) {
+      switch (stop) {
+        case ScanStop::kWord:
+          return (unsigned char) c <= ' ' || c == '\'' || c == '"'
+              || c == '\\';
+        case ScanStop::kDoubleQuoted:
+          return c == '"' || c == '\\';
+        case ScanStop::kSingleQuoted:
+          return c == '\'';
+        default:
           return true;
-        }
       }
-      return false;
     }
     
-    bool parseArgsR(Internal::ArgReader &argReader) final override {
-      if (argReader.hasLongFlag() == argReader.hasShortFlag()) {
-        if (argReader.hasLongFlag()) {
-          fprintf(stderr,
-              "Internal error: concurrently read flags \"%s\", '%c'\n",
-              argReader.getLongFlag().c_str(), argReader.getShortFlag());
-        } else if (argReader.hasValue()) {
-          fprintf(stderr, "Expected flag name, got \"%s\"\n",
-              argReader.getValue().c_str());
-        } else {
-          fputs("Internal error: flag parser invoked with no data", stderr);
+    /**
+     * Returns the index of the first character at or after `i` at which the
+     * given kind of scan stops, or `length` if there is none. Outside quotes,
+     * every control character stops the scan, though only blanks end a word.
+     * Sixteen characters are checked at a time where SSE2 is available.
+     */
+    inline size_t scanCommand(const char *text, size_t i, size_t length,
+                              ScanStop stop) {
+#   if defined(__SSE2__) && !defined(DEEPFLAGS_NO_SIMD)
+      const __m128i quote = _mm_set1_epi8('\'');
+      const __m128i doubleQuote = _mm_set1_epi8('"');
+      const __m128i backslash = _mm_set1_epi8('\\');
+      const __m128i space = _mm_set1_epi8(' ');
+      for (; i + 16 <= length; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) (text + i));
+        __m128i hits;
+        switch (stop) {
+          case ScanStop::kWord: {
+            // Characters no greater than a space, compared unsigned.
+            __m128i controls =
+                _mm_cmpeq_epi8(_mm_min_epu8(chunk, space), chunk);
+            hits = _mm_or_si128(
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                             _mm_cmpeq_epi8(chunk, doubleQuote)),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, backslash), controls));
+            break;
+          }
+          case ScanStop::kDoubleQuoted:
+            hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, doubleQuote),
+                                _mm_cmpeq_epi8(chunk, backslash));
+            break;
+          case ScanStop::kSingleQuoted:
+          default:
+            hits = _mm_cmpeq_epi8(chunk, quote);
+            break;
+        }
+        if (unsigned mask = _mm_movemask_epi8(hits)) {
+          return i + __builtin_ctz(mask);
         }
-        return false;
       }
-      
-      if ((hasLongName() && argReader.hasLongFlag()
-              && getLongName() == argReader.getLongFlag())
-          || (hasShortName() && argReader.hasShortFlag()
-              && getShortName() == argReader.getShortFlag())) {
-        argReader.parseNextArg();
+#   endif
+      while (i < length && !stopsScan(text[i], stop)) {
+        ++i;
+      }
+      return i;
+    }
+  }
+  
+  /**
+   * Splits a command line into arguments following POSIX shell rules for
+   * whitespace, quoting, escaping, and comments. Expansions and operators are
+   * not interpreted. Runs of ordinary characters are found with a vectorized
+   * scan; arguments are unescaped and NUL-terminated in place, so the argument
+   * vector points into the line and only escaped text is moved.
+   */
+  class CommandSplitter {
+    std::string buffer;
+    std::vector<size_t> starts;
+    std::vector<const char*> args;
+    
+    static bool isBlank(char c) {
+      return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+    }
+    
+    /// Moves [read, end) to `write`, unless it is already there.
+    static void shift(char *text, size_t &read, size_t &write, size_t end) {
+      if (write != read) {
+        memmove(text + write, text + read, end - read);
       }
+      write += end - read;
+      read = end;
+    }
+    
+    /**
+     * Splits the given text, which must be followed by a writable NUL, in
+     * place. Records where each argument starts.
+     */
+    bool splitText(char *text, size_t length) {
+      using Internal::ScanStop;
+      using Internal::scanCommand;
       
-      while (!argReader.atEnd()) {
-        if (argReader.hasLongFlag()) {
-          auto flag = membersByLongName.find(argReader.getLongFlag());
-          if (flag == membersByLongName.end() || pAtCapacity(*flag->second)) {
-            return true;
-          }
-          unsigned pos = argReader.tell();
-          if (!invokeParse(flag->second, argReader)) {
-            return false;
-          }
-          if (argReader.tell() == pos) {
-            return true;
-          }
-        } else {
-          auto flag = membersByShortName.find(argReader.getShortFlag());
-          if (flag == membersByShortName.end() || pAtCapacity(*flag->second)) {
-            return true;
+      size_t read = 0, write = 0;
+      for (;;) {
+        while (read < length && isBlank(text[read])) {
+          ++read;
+        }
+        if (read >= length || text[read] == '#') {
+          break;
+        }
+        starts.push_back(write);
+        while (read < length) {
+          shift(text, read, write,
+                scanCommand(text, read, length, ScanStop::kWord));
+          if (read >= length || isBlank(text[read])) {
+            break;
           }
-          if (!invokeParse(flag->second, argReader)) {
-            return false;
+          const char c = text[read++];
+          if (c == '\'') {
+            const size_t end =
+                scanCommand(text, read, length, ScanStop::kSingleQuoted);
+            if (end >= length) {
+              fputs("Unterminated single quote in command\n", stderr);
+              return false;
+            }
+            shift(text, read, write, end);
+            ++read;
+          } else if (c == '"') {
+            for (;;) {
+              shift(text, read, write,
+                    scanCommand(text, read, length, ScanStop::kDoubleQuoted));
+              if (read >= length) {
+                fputs("Unterminated double quote in command\n", stderr);
+                return false;
+              }
+              if (text[read++] == '"') {
+                break;
+              }
+              // Within double quotes, backslashes only escape a few
+              // characters, and are otherwise kept.
+              const char e = read < length ? text[read] : 0;
+              if (e == '\n') {
+                ++read;
+              } else if (e == '"' || e == '\\' || e == '$' || e == '`') {
+                text[write++] = e;
+                ++read;
+              } else {
+                text[write++] = '\\';
+              }
+            }
+          } else if (c == '\\') {
+            if (read >= length) {
+              fputs("Unterminated escape in command\n", stderr);
+              return false;
+            }
+            if (text[read] != '\n') {
+              text[write++] = text[read];
+            }
+            ++read;
+          } else {
+            // A control character other than a blank.
+            text[write++] = c;
           }
         }
+        // Terminate the argument where the blank that ended it was, or on
+        // the NUL following the text.
+        if (read < length) {
+          ++read;
+        }
+        text[write++] = 0;
       }
       return true;
     }
     
+    /// Points the argument vector at the arguments found in the given text.
+    void collect(const char *base) {
+      for (size_t start : starts) {
+        args.push_back(base + start);
+      }
+      args.push_back(nullptr);
+    }
+    
    public:
-    void addFlag(FlagBase *flag) {
-      members.push_back(flag);
-      if (flag->hasLongName()) {
-        membersByLongName[flag->getLongName()] = flag;
+    /**
+     * Splits a copy of the given line. If a program name is given, it becomes
+     * the first argument, ahead of those from the line.
+     * @return true on success, false if a quote or escape is left open
+     */
+    bool split(std::string_view line, const char *programName = nullptr) {
+      buffer.assign(line.data(), line.length());
+      return splitInPlace(buffer, programName);
+    }
+    
+    /**
+     * Splits the given line without copying it. The line is overwritten with
+     * the unescaped arguments, which remain valid until it is modified.
+     * @return true on success, false if a quote or escape is left open
+     */
+    bool splitInPlace(std::string &line, const char *programName = nullptr) {
+      starts.clear();
+      args.clear();
+      if (programName) {
+        args.push_back(programName);
       }
-      if (flag->hasShortName()) {
-        membersByShortName[flag->getShortName()] = flag;
+      if (!splitText(&line[0], line.length())) {
+        args.push_back(nullptr);
+        return false;
       }
+      collect(line.c_str());
+      return true;
     }
     
-    void printHelp(std::ostream &stream) const {
-      BasicHelpPrinter printer(stream);
-      printHelp(printer);
+    /// Returns the number of arguments, including any program name.
+    int argc() const {
+      return int(args.size()) - 1;
     }
     
-    void printHelp(HelpPrinter &printer) const override {
-      printer.enterFlag(makeProps());
-      for (Internal::FlagBase *flag : members) {
-        printHelpR(flag, printer);
+    /// Returns the arguments, followed by a null pointer.
+    const char *const *argv() const {
+      return args.data();
+    }
+  };
+  
+  /**
+   * Reads commands one line at a time, parses each into a flag group, and
+   * hands the group to a handler. Groups are registered once and reset before
+   * each line, so a line costs little more than splitting it.
+   * 
+   * The first word of each line names the command. If a handler is
+   * registered for the empty name, it receives every line that does not
+   * start with a known command, with the whole line parsed as flags.
+   */
+  class CommandLoop {
+    struct Command {
+      Internal::FlagBase *flags;
+      std::function<void()> handler;
+    };
+    std::map<std::string, Command, std::less<>> commands;
+    CommandSplitter splitter;
+    bool stopped = false;
+    
+   public:
+    /**
+     * Registers a command. Each line naming it is parsed into the given
+     * flags, which must outlive this loop, and then passed to the handler,
+     * which may be any callable taking a Group&.
+     */
+    template<typename Group, typename F> void on(std::string name,
+                                                 Group &flags, F handler) {
+      Group *group = &flags;
+      commands[std::move(name)] = Command {
+        group, [group, handler = std::move(handler)]() mutable {
+          handler(*group);
+        }
+      };
+    }
+    
+    /// Ends run() once the current line has been handled.
+    void stop() {
+      stopped = true;
+    }
+    
+    /**
+     * Splits, parses, and dispatches one line. Blank lines and comments are
+     * ignored.
+     * @return true if the line was handled, false if it was malformed or
+     *         named no command
+     */
+    bool handleLine(std::string_view line) {
+      if (!splitter.split(line, "")) {
+        return false;
       }
-      printer.leaveFlag();
+      if (splitter.argc() < 2) {
+        return true;
+      }
+      
+      const char *const *argv = splitter.argv() + 1;
+      int argc = splitter.argc() - 1;
+      auto command = commands.find(std::string_view(argv[0]));
+      if (command == commands.end()) {
+        command = commands.find(std::string_view());
+        if (command == commands.end()) {
+          fprintf(stderr, "Unknown command \"%s\"\n", argv[0]);
+          return false;
+        }
+        // Leave the empty program name in place of the command.
+        --argv;
+        ++argc;
+      }
+      
+      Internal::FlagBase &flags = *command->second.flags;
+      flags.reset();
+      if (!flags.parseArgs(argc, argv)) {
+        return false;
+      }
+      command->second.handler();
+      return true;
+    }
+    
+    /**
+     * Handles each line of the given stream until it ends or stop() is
+     * called.
+     * @return the number of lines which could not be handled
+     */
+    size_t run(std::istream &in) {
+      stopped = false;
+      size_t failures = 0;
+      std::string line;
+      while (!stopped && std::getline(in, line)) {
+        failures += !handleLine(line);
+      }
+      return failures;
     }
     
-    FlagGroup(CtorArgs args): FlagBase(args) {}
-    FlagGroup(): FlagBase(CtorArgs()) {}
+#if defined(__unix__) || defined(__APPLE__)
+    /**
+     * Handles each line read from the given file descriptor, such as a pipe
+     * or a connected socket, until it reaches end of file, fails, or stop()
+     * is called.
+     * @return the number of lines which could not be handled
+     */
+    size_t run(int fd) {
+      stopped = false;
+      size_t failures = 0;
+      std::string pending;
+      char chunk[65536];
+      while (!stopped) {
+        ssize_t count = ::read(fd, chunk, sizeof(chunk));
+        if (count < 0 && errno == EINTR) {
+          continue;
+        }
+        if (count <= 0) {
+          break;
+        }
+        pending.append(chunk, count);
+        size_t start = 0;
+        for (size_t end; !stopped
+             && (end = pending.find('\n', start)) != std::string::npos;
+             start = end + 1) {
+          failures += !handleLine(
+              std::string_view(pending).substr(start, end - start));
+        }
+        pending.erase(0, start);
+      }
+      if (!stopped && !pending.empty()) {
+        failures += !handleLine(pending);
+      }
+      return failures;
+    }
+#endif
   };
-  
-  inline void Internal::FlagBase::addThisTo(FlagGroup *group) {
-    group->addFlag(this);
-  }
-  
-  inline Internal::CtorArgs flag(FlagGroup *group, std::string name) {
-    return Internal::CtorArgs(group, name);
-  }
-  
-  inline Internal::CtorArgs flag(
-      FlagGroup *group, std::string name, char shortname) {
-    return Internal::CtorArgs(group, name, shortname);
-  }
-  
-  inline Internal::CtorArgs flag(FlagGroup *group, char shortname) {
-    return Internal::CtorArgs(group, shortname);
-  }
 }
 
 #endif // FLAGS_h
@@ -0,0 +1,546 @@
+/*
+ * Parse-throughput benchmarks. Each benchmark generates a command line, then
+ * reports the best observed parse time per token over several trials.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <limits>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "DeepFlags.hpp"
+#if defined(__unix__) || defined(__APPLE__)
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+using std::vector;
+using std::string;
+
+namespace FlagsBench {
+  enum class Feature { kSse2, kSse4, kAvx, kAvx2, kAvx512, kBmi2, kNeon };
+}
+
+template<> struct Flags::EnumNames<FlagsBench::Feature> {
+  static constexpr Flags::EnumName<FlagsBench::Feature> values[] = {
+    { "sse2", FlagsBench::Feature::kSse2 },
+    { "sse4", FlagsBench::Feature::kSse4 },
+    { "avx", FlagsBench::Feature::kAvx },
+    { "avx2", FlagsBench::Feature::kAvx2 },
+    { "avx512", FlagsBench::Feature::kAvx512 },
+    { "bmi2", FlagsBench::Feature::kBmi2 },
+    { "neon", FlagsBench::Feature::kNeon },
+  };
+};
+
+namespace FlagsBench {
+
+  /// Owns generated arguments and presents them as an argv array.
+  class ArgList {
+    std::deque<string> args;
+    vector<const char*> argv;
+
+   public:
+    ArgList(): args{ "flagsbench" }, argv{ args[0].c_str() } {}
+
+    void add(string arg) {
+      args.push_back(arg);
+      argv.push_back(args.back().c_str());
+    }
+
+    size_t tokens() const { return args.size() - 1; }
+    int argc() const { return argv.size(); }
+    const char* const* data() const { return argv.data(); }
+  };
+
+  /**
+   * Parses the given arguments into fresh instances of Group until a fixed
+   * amount of time has been measured, several times over, and prints the best
+   * observed time per token.
+   */
+  template<typename Group> void run(const char *name, const ArgList &args) {
+    typedef std::chrono::steady_clock Clock;
+    double best = std::numeric_limits<double>::infinity();
+    for (int trial = 0; trial < 5; ++trial) {
+      Clock::duration elapsed(0);
+      size_t parses = 0;
+      while (elapsed < std::chrono::milliseconds(50)) {
+        Group flags;
+        Clock::time_point start = Clock::now();
+        if (!flags.parseArgs(args.argc(), args.data())) {
+          fprintf(stderr, "%s: parse failed\n", name);
+          return;
+        }
+        elapsed += Clock::now() - start;
+        ++parses;
+      }
+      double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+      best = std::min(best, ns / parses / args.tokens());
+    }
+    printf("%-40s %10zu tokens %10.1f ns/token\n", name, args.tokens(), best);
+  }
+
+  /// A group of many members, each of which can be given once.
+  template<int kWidth> struct WideGroup: Flags::FlagGroup {
+    std::deque<Flags::Flag<int>> members;
+    WideGroup(CtorArgs args): FlagGroup(args) {
+      for (int i = 0; i < kWidth; ++i) {
+        members.emplace_back(Flags::flag(this, "w" + std::to_string(i)));
+      }
+    }
+  };
+
+  /**
+   * A wide group nested in another, re-entered for every member. Each time
+   * the parent dispatches to the wide group, it first asks whether the group
+   * is at capacity, by which point more of its members are saturated.
+   */
+  template<int kWidth> struct NestedWideGroup: Flags::FlagGroup {
+    Flags::Flag<WideGroup<kWidth>> inner = Flags::flag(this, "inner");
+    Flags::Flag<vector<int>> top = Flags::flag(this, "top");
+
+    static ArgList args() {
+      ArgList res;
+      for (int i = 0; i < kWidth; ++i) {
+        res.add("--inner");
+        res.add("--w" + std::to_string(i));
+        res.add(std::to_string(i));
+        res.add("--top");
+        res.add(std::to_string(i));
+      }
+      return res;
+    }
+  };
+
+  template<int kWidth> void benchmarkReentry() {
+    char name[64];
+    snprintf(name, sizeof(name), "re-enter %d-member group", kWidth);
+    run<NestedWideGroup<kWidth>>(name, NestedWideGroup<kWidth>::args());
+  }
+
+  static void benchmarkAtCapacity() {
+    benchmarkReentry<8>();
+    benchmarkReentry<64>();
+    benchmarkReentry<512>();
+    benchmarkReentry<4096>();
+  }
+
+  struct DoubleList: Flags::FlagGroup {
+    Flags::Flag<Flags::Sequential<double>> values = Flags::flag(this, "values");
+  };
+
+  static void benchmarkConversion() {
+    for (size_t count : { 1000, 1000000 }) {
+      ArgList args;
+      args.add("--values");
+      for (size_t i = 1; i < count; ++i) {
+        args.add(std::to_string(i * 0.125));
+      }
+      char name[64];
+      snprintf(name, sizeof(name), "Sequential<double> of %zu", count);
+      run<DoubleList>(name, args);
+    }
+  }
+
+  struct IndexList: Flags::FlagGroup {
+    Flags::Flag<vector<int>> inds = Flags::flag(this, "ind");
+  };
+
+  struct BoundedIndexList: Flags::FlagGroup {
+    Flags::Flag<vector<int>> inds =
+        Flags::flag(this, "ind").range(0, 100000000);
+  };
+
+  static void benchmarkIntegers() {
+    for (size_t count : { 1000, 1000000 }) {
+      ArgList args;
+      args.add("--ind");
+      for (size_t i = 1; i < count; ++i) {
+        args.add(std::to_string(i * 7919 % 100000000));
+      }
+      char name[64];
+      snprintf(name, sizeof(name), "vector<int> of %zu", count);
+      run<IndexList>(name, args);
+      snprintf(name, sizeof(name), "vector<int> of %zu, with range()", count);
+      run<BoundedIndexList>(name, args);
+    }
+  }
+
+  template<bool kConstrained> struct SourceFile: Flags::FlagGroup {
+    Flags::Flag<string> file = Flags::flag(this, "file", 'f');
+    Flags::Switch readStdin = Flags::flag(this, "stdin");
+    Flags::Flag<string> label = Flags::flag(this, "label", 'l');
+    Flags::Switch createIfMissing = Flags::flag(this, 'p');
+    SourceFile(CtorArgs args): FlagGroup(args) {
+      if (kConstrained) {
+        mutuallyExclusive({ &file, &readStdin });
+        requireOneOf({ &file, &readStdin });
+        dependsOn(createIfMissing, { &file });
+      }
+    }
+  };
+
+  template<bool kConstrained> struct SourceFiles: Flags::FlagGroup {
+    Flags::Flag<Flags::Repeated<SourceFile<kConstrained>>> files =
+        Flags::flag(this, "display", 'D');
+  };
+
+  static void benchmarkConstraints() {
+    ArgList args;
+    for (int i = 0; i < 100000; ++i) {
+      args.add("-D");
+      args.add("-f");
+      args.add("file.txt");
+      args.add("-l");
+      args.add("label");
+      args.add("-p");
+    }
+    run<SourceFiles<false>>("100k groups without constraints", args);
+    run<SourceFiles<true>>("100k groups with 3 constraints", args);
+  }
+
+  struct FeatureNames: Flags::FlagGroup {
+    Flags::Flag<vector<string>> features = Flags::flag(this, "features");
+  };
+
+  struct FeatureEnums: Flags::FlagGroup {
+    Flags::Flag<vector<Feature>> features = Flags::flag(this, "features");
+  };
+
+  struct FeatureSet: Flags::FlagGroup {
+    Flags::Flag<Flags::EnumSet<Feature>> features =
+        Flags::flag(this, "features");
+  };
+
+  struct BoolList: Flags::FlagGroup {
+    Flags::Flag<vector<bool>> bits = Flags::flag(this, "bits");
+  };
+
+  static void benchmarkEnums() {
+    static const char *const names[] = {
+      "sse2", "sse4", "avx", "avx2", "avx512", "bmi2", "neon"
+    };
+    ArgList args;
+    args.add("--features");
+    for (size_t i = 1; i < 100000; ++i) {
+      args.add(names[i * 5 % 7]);
+    }
+    run<FeatureNames>("vector<string> of 100000 names", args);
+    run<FeatureEnums>("vector<enum> of 100000 names", args);
+    run<FeatureSet>("EnumSet of 100000 names", args);
+
+    static const char *const bools[] = {
+      "true", "no", "1", "off", "yes", "False", "0", "ON"
+    };
+    ArgList bits;
+    bits.add("--bits");
+    for (size_t i = 1; i < 100000; ++i) {
+      bits.add(bools[i * 3 % 8]);
+    }
+    run<BoolList>("vector<bool> of 100000", bits);
+  }
+
+  template<typename Map> struct Defines: Flags::FlagGroup {
+    Flags::Flag<Map> defines = Flags::flag(this, "define");
+  };
+
+  static void benchmarkMaps() {
+    ArgList args;
+    args.add("--define");
+    for (size_t i = 1; i < 100000; ++i) {
+      args.add("KEY_" + std::to_string(i * 7919 % 100000) + "=" +
+               std::to_string(i));
+    }
+    run<Defines<std::map<string, int>>>("map of 100000 defines", args);
+    run<Defines<std::unordered_map<string, int>>>(
+        "unordered_map of 100000 defines", args);
+    run<Defines<Flags::FlatMap<string, int>>>(
+        "FlatMap of 100000 defines", args);
+  }
+
+  /// Returns the best observed time per call of `fn`, in nanoseconds.
+  template<typename Fn> double timePerCall(Fn fn) {
+    typedef std::chrono::steady_clock Clock;
+    double best = std::numeric_limits<double>::infinity();
+    for (int trial = 0; trial < 5; ++trial) {
+      Clock::duration elapsed(0);
+      size_t calls = 0;
+      Clock::time_point start = Clock::now();
+      while (elapsed < std::chrono::milliseconds(50)) {
+        for (int i = 0; i < 100; ++i) {
+          fn();
+        }
+        calls += 100;
+        elapsed = Clock::now() - start;
+      }
+      double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+      best = std::min(best, ns / calls);
+    }
+    return best;
+  }
+
+  template<typename List> struct InputFiles: Flags::FlagGroup {
+    Flags::Flag<List> inputs = Flags::flag(this, "input");
+  };
+
+  static void benchmarkStringLists() {
+    ArgList args;
+    args.add("--input");
+    for (size_t i = 1; i < 100000; ++i) {
+      args.add("/data/projects/example/inputs/file-" + std::to_string(i));
+    }
+    run<InputFiles<vector<string>>>("vector<string> of 100000 paths", args);
+    run<InputFiles<Flags::StringList>>("StringList of 100000 paths", args);
+    run<InputFiles<Flags::Stream<std::string_view>>>(
+        "Stream of 100000 paths", args);
+
+    InputFiles<vector<string>> vectorFlags;
+    InputFiles<Flags::StringList> listFlags;
+    vectorFlags.parseArgs(args.argc(), args.data());
+    listFlags.parseArgs(args.argc(), args.data());
+    size_t total = 0;
+    double vectorWalk = timePerCall([&] {
+      for (const string &path : vectorFlags.inputs.value) {
+        total += path.length();
+      }
+    }) / args.tokens();
+    double listWalk = timePerCall([&] {
+      for (std::string_view path : listFlags.inputs.value) {
+        total += path.length();
+      }
+    }) / args.tokens();
+    printf("%-40s %10.2f ns/path\n", "iterate vector<string>", vectorWalk);
+    printf("%-40s %10.2f ns/path\n", "iterate StringList", listWalk);
+    if (!total) {
+      puts("");
+    }
+  }
+
+  template<typename Text> struct LabeledDisplay: Flags::FlagGroup {
+    Flags::Flag<Text> label = Flags::flag(this, "label", 'l');
+    LabeledDisplay(CtorArgs args): FlagGroup(args) {}
+  };
+
+  template<typename Text> struct LabeledDisplays: Flags::FlagGroup {
+    Flags::Flag<Flags::Repeated<LabeledDisplay<Text>>> displays =
+        Flags::flag(this, "display", 'D');
+  };
+
+  /// Counts the displays labeled as the first one is.
+  template<typename Text>
+  size_t countMatching(const LabeledDisplays<Text> &flags) {
+    const auto &displays = flags.displays.value;
+    size_t matching = 0;
+    for (const auto &display : displays) {
+      matching += display.label.value == displays[0].label.value;
+    }
+    return matching;
+  }
+
+  static void benchmarkInterning() {
+    const string labels[] = {
+      "Intro, final cut", "Main sequence, director's cut",
+      "Credits, international version", "Outtakes and behind the scenes"
+    };
+    ArgList args;
+    for (int i = 0; i < 100000; ++i) {
+      args.add("-D");
+      args.add("-l");
+      args.add(labels[i * 7 % 4]);
+    }
+    run<LabeledDisplays<string>>("100k labels as string", args);
+    run<LabeledDisplays<Flags::InternedString>>(
+        "100k labels as InternedString", args);
+
+    LabeledDisplays<string> strings;
+    LabeledDisplays<Flags::InternedString> interned;
+    strings.parseArgs(args.argc(), args.data());
+    interned.parseArgs(args.argc(), args.data());
+    size_t total = 0;
+    double compareStrings = timePerCall([&] {
+      total += countMatching(strings);
+    }) / 100000;
+    double compareInterned = timePerCall([&] {
+      total += countMatching(interned);
+    }) / 100000;
+    printf("%-40s %10.2f ns/label\n", "compare string labels", compareStrings);
+    printf("%-40s %10.2f ns/label\n", "compare interned labels",
+           compareInterned);
+    if (!total) {
+      puts("");
+    }
+  }
+
+  /// Stands in for a stat() or DNS lookup which takes a while to answer.
+  static string slowCheck(std::string_view) {
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+    return "";
+  }
+
+  struct CheckedAfterParsing: Flags::FlagGroup {
+    Flags::Flag<vector<string>> hosts = Flags::flag(this, "host");
+    bool parseArgs(int argc, const char *const *argv) {
+      if (!FlagGroup::parseArgs(argc, argv)) {
+        return false;
+      }
+      for (const string &host : hosts.value) {
+        if (!slowCheck(host).empty()) {
+          return false;
+        }
+      }
+      return true;
+    }
+  };
+
+  struct CheckedWhileParsing: Flags::FlagGroup {
+    Flags::Flag<vector<string>> hosts =
+        Flags::flag(this, "host").checkAsync(slowCheck);
+  };
+
+  static void benchmarkAsyncChecks() {
+    ArgList args;
+    args.add("--host");
+    for (int i = 1; i < 64; ++i) {
+      args.add("host-" + std::to_string(i) + ".example.com");
+    }
+    run<CheckedAfterParsing>("64 slow checks after parsing", args);
+    run<CheckedWhileParsing>("64 slow checks with checkAsync", args);
+  }
+
+#if defined(__unix__) || defined(__APPLE__)
+  struct StatAfterParsing: Flags::FlagGroup {
+    Flags::Flag<vector<string>> inputs = Flags::flag(this, "input");
+    bool parseArgs(int argc, const char *const *argv) {
+      if (!FlagGroup::parseArgs(argc, argv)) {
+        return false;
+      }
+      for (const string &input : inputs.value) {
+        struct stat status;
+        if (stat(input.c_str(), &status)) {
+          return false;
+        }
+      }
+      return true;
+    }
+  };
+
+  struct PathsMustExist: Flags::FlagGroup {
+    Flags::Flag<vector<Flags::Path>> inputs =
+        Flags::flag(this, "input").mustExist();
+  };
+
+  static void benchmarkPathChecks() {
+    char pattern[] = "/tmp/flagsbenchXXXXXX";
+    const string root = mkdtemp(pattern);
+    ArgList args;
+    args.add("--input");
+    for (int i = 1; i < 20000; ++i) {
+      args.add(root + "/input-" + std::to_string(i));
+      fclose(fopen(args.data()[args.argc() - 1], "w"));
+    }
+    run<StatAfterParsing>("20000 paths, stat after parsing", args);
+    run<PathsMustExist>("20000 paths with mustExist()", args);
+    for (int i = 2; i < args.argc(); ++i) {
+      unlink(args.data()[i]);
+    }
+    rmdir(root.c_str());
+  }
+#endif
+
+  struct DisplayFile: Flags::FlagGroup {
+    Flags::Flag<string> file = Flags::flag(this, "file", 'f');
+    Flags::Flag<string> label = Flags::flag(this, "label", 'l');
+    Flags::Flag<vector<int>> bookmarks = Flags::flag(this, "bookmark", 'b');
+    Flags::Switch createIfMissing = Flags::flag(this, 'p');
+  };
+
+  static void benchmarkCommandLoop() {
+    const char *line = "display -f some/file.txt -l 'File 1' -b 1 3 5 -p";
+    Flags::CommandSplitter splitter;
+    double split = timePerCall([&] { splitter.split(line, ""); });
+    printf("%-40s %10.1f ns/line\n", "split command line", split);
+    
+    const string job =
+        "render --input /data/projects/example/scenes/intro.scene"
+        " --output '/data/projects/example/renders/intro final.mp4'"
+        " --label \"Intro, final cut\" --frames 1 2 3 4 5 6 7 8 --quality high";
+    double splitJob = timePerCall([&] { splitter.split(job); });
+    printf("%-40s %10.1f ns/line\n", "split long job line", splitJob);
+    
+    DisplayFile flags;
+    size_t handled = 0;
+    Flags::CommandLoop loop;
+    loop.on("display", flags, [&](DisplayFile&) { ++handled; });
+    double dispatch = timePerCall([&] { loop.handleLine(line); });
+    printf("%-40s %10.1f ns/line\n", "split, parse and dispatch", dispatch);
+  }
+
+  template<bool kPassUnknown> struct LibraryA: Flags::FlagGroup {
+    Flags::Flag<vector<int>> a = Flags::flag(this, "a");
+    LibraryA() { if (kPassUnknown) passUnknownFlags(); }
+  };
+
+  template<bool kPassUnknown> struct LibraryB: Flags::FlagGroup {
+    Flags::Flag<vector<int>> b = Flags::flag(this, "b");
+    LibraryB() { if (kPassUnknown) passUnknownFlags(); }
+  };
+
+  template<bool kPassUnknown> struct LibraryC: Flags::FlagGroup {
+    Flags::Flag<vector<int>> c = Flags::flag(this, "c");
+    LibraryC() { if (kPassUnknown) passUnknownFlags(); }
+  };
+
+  /// Every library group parses the whole command line, skipping the rest.
+  struct SeparateLibraries {
+    LibraryA<true> a;
+    LibraryB<true> b;
+    LibraryC<true> c;
+    bool parseArgs(int argc, const char *const *argv) {
+      return a.parseArgs(argc, argv) && b.parseArgs(argc, argv)
+          && c.parseArgs(argc, argv);
+    }
+  };
+
+  /// One pass hands each flag to the library group which declares it.
+  struct PartitionedLibraries {
+    LibraryA<false> a;
+    LibraryB<false> b;
+    LibraryC<false> c;
+    Flags::MultiParser parser { &a, &b, &c };
+    bool parseArgs(int argc, const char *const *argv) {
+      return parser.parseArgs(argc, argv);
+    }
+  };
+
+  static void benchmarkMultipleGroups() {
+    ArgList args;
+    for (int i = 0; i < 10000; ++i) {
+      args.add(i % 3 == 0 ? "--a" : i % 3 == 1 ? "--b" : "--c");
+      args.add(std::to_string(i));
+      args.add(std::to_string(i + 1));
+    }
+    run<SeparateLibraries>("3 groups, each skipping the others", args);
+    run<PartitionedLibraries>("3 groups through one MultiParser", args);
+  }
+}
+
+int main() {
+  FlagsBench::benchmarkAtCapacity();
+  FlagsBench::benchmarkConversion();
+  FlagsBench::benchmarkIntegers();
+  FlagsBench::benchmarkEnums();
+  FlagsBench::benchmarkMaps();
+  FlagsBench::benchmarkStringLists();
+  FlagsBench::benchmarkInterning();
+  FlagsBench::benchmarkAsyncChecks();
+#if defined(__unix__) || defined(__APPLE__)
+  FlagsBench::benchmarkPathChecks();
+#endif
+  FlagsBench::benchmarkCommandLoop();
+  FlagsBench::benchmarkConstraints();
+  FlagsBench::benchmarkMultipleGroups();
+  return 0;
+}
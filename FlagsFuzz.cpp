@@ -0,0 +1,284 @@
+/*
+ * libFuzzer target for ArgReader and FlagGroup parsing.
+ *
+ * The fuzz input is split on NUL bytes into argv, which is parsed against
+ * each of the schemas below. The same bytes are also fed to the help printer
+ * as a description block, to exercise its word wrapping.
+ *
+ * Besides crashes, the target reports any input whose parse time is far
+ * outside a linear budget for its size, and periodically prints the number of
+ * executions per second to stderr.
+ *
+ * Build with clang++ -fsanitize=fuzzer,address. Define
+ * DEEPFLAGS_FUZZ_STANDALONE to instead build a driver that runs the files
+ * named on its command line, or random inputs if none are given.
+ */
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "DeepFlags.hpp"
+using std::vector;
+using std::string;
+
+namespace FlagsFuzz {
+
+  /// Fixed portion of the time budget for a single input, in nanoseconds.
+  constexpr double kBaseBudgetNs = 1e7;
+  /// Per-byte portion of the time budget for a single input, in nanoseconds.
+  constexpr double kBudgetNsPerByte = 5e4;
+  /// Seconds between throughput reports.
+  constexpr double kReportInterval = 10;
+
+  /// Mirrors the schema in Example.cpp.
+  namespace ExampleSchema {
+    struct DisplayFile : Flags::FlagGroup {
+      Flags::Flag<std::string> file = Flags::flag(this, "file", 'f');
+      Flags::Flag<std::string> label = Flags::flag(this, "label", 'l');
+      Flags::Flag<std::vector<int>> bookmarks =
+          Flags::flag(this, "bookmark", 'b');
+      Flags::Switch createIfMissing = Flags::flag(this, 'p');
+      DisplayFile(CtorArgs args): FlagGroup(args) {}
+    };
+
+    struct AllFlags : Flags::FlagGroup {
+      Flags::Flag<Flags::Repeated<DisplayFile>> files =
+          Flags::flag(this, "display", 'D');
+    };
+  }
+
+  /// Mirrors the schemas in FlagsTest.cpp.
+  namespace TestSchemas {
+    struct EntityFlags: Flags::FlagGroup {
+      Flags::Flag<int64_t> id = Flags::flag(this, "id");
+      Flags::Flag<string>  name = Flags::flag(this, "name");
+      Flags::Flag<double>  x = Flags::flag(this, "x", 'x');
+      Flags::Flag<double>  y = Flags::flag(this, "y", 'y');
+      EntityFlags(CtorArgs args): FlagGroup(args) {}
+    };
+
+    struct BasicFlags: Flags::FlagGroup {
+      Flags::Flag<bool> alive = Flags::flag(this, "alive");
+      Flags::Flag<int64_t> param = Flags::flag(this, "param");
+      Flags::Flag<vector<EntityFlags>> entities = Flags::flag(this, "entity");
+      Flags::Flag<vector<int>> inds = Flags::flag(this, "ind");
+      Flags::Switch toggle1 = Flags::flag(this, "toggle");
+      Flags::Switch toggle2 = Flags::flag(this, "toggle2");
+    };
+
+    struct RepeatableGroup: Flags::FlagGroup {
+      Flags::Flag<Flags::Sequential<int>> id = Flags::flag(this, "weights");
+      RepeatableGroup(CtorArgs args): FlagGroup(args) {}
+    };
+
+    struct SequentialFlags: Flags::FlagGroup {
+      Flags::Flag<int64_t>                 param = Flags::flag(this, "param");
+      Flags::Flag<vector<RepeatableGroup>> lists = Flags::flag(this, "lists");
+    };
+  }
+
+  /// Covers every primitive value type with both long and short names.
+  struct PrimitiveFlags: Flags::FlagGroup {
+    Flags::Flag<bool>        b   = Flags::flag(this, "bool", 'b');
+    Flags::Flag<int8_t>      i8  = Flags::flag(this, "i8", '1');
+    Flags::Flag<int16_t>     i16 = Flags::flag(this, "i16", '2');
+    Flags::Flag<int32_t>     i32 = Flags::flag(this, "i32", '3');
+    Flags::Flag<int64_t>     i64 = Flags::flag(this, "i64", '4');
+    Flags::Flag<uint8_t>     u8  = Flags::flag(this, "u8", '5');
+    Flags::Flag<uint16_t>    u16 = Flags::flag(this, "u16", '6');
+    Flags::Flag<uint32_t>    u32 = Flags::flag(this, "u32", '7');
+    Flags::Flag<uint64_t>    u64 = Flags::flag(this, "u64", '8');
+    Flags::Flag<float>       f   = Flags::flag(this, "float", 'f');
+    Flags::Flag<double>      d   = Flags::flag(this, "double", 'd');
+    Flags::Flag<long double> ld  = Flags::flag(this, "ldouble", 'L');
+    Flags::Flag<string>      s   = Flags::flag(this, "string", 's');
+    Flags::Flag<Flags::InternedString> in = Flags::flag(this, "interned");
+    Flags::Flag<vector<Flags::Path>> paths =
+        Flags::flag(this, "path").mustExist().splitOn(':');
+    Flags::Flag<string>      chk = Flags::flag(this, "checked")
+        .checkAsync([](std::string_view v) {
+          return v.size() > 3 ? string("too long") : string();
+        });
+    Flags::Flag<Flags::Sequential<double>> seq = Flags::flag(this, "seq");
+    Flags::Flag<Flags::Repeated<string>>   rep = Flags::flag(this, "rep", 'r');
+    Flags::Flag<Flags::IntRanges<int16_t>> rng = Flags::flag(this, "rng", 'R');
+    Flags::Flag<std::tuple<int, string>>   tup = Flags::flag(this, "tup", 't');
+    Flags::Flag<std::array<double, 2>>     arr = Flags::flag(this, "arr");
+    Flags::Flag<std::optional<int>>        opt = Flags::flag(this, "opt");
+    Flags::Flag<vector<bool>>              bits = Flags::flag(this, "bits");
+    Flags::Flag<Flags::StringList>         list =
+        Flags::flag(this, "list").splitOn(':');
+    Flags::Flag<Flags::Stream<uint8_t>>    stream =
+        Flags::flag(this, "stream").splitOn(':').range(1, 200);
+    Flags::Flag<std::map<string, int>>     map = Flags::flag(this, "map", 'm');
+    Flags::Flag<Flags::FlatMap<int, int>>  flat = Flags::flag(this, "flat")
+        .onDuplicateKey(Flags::DuplicateKeys::kError);
+    Flags::Flag<std::variant<uint8_t, float, string>> var =
+        Flags::flag(this, "var", 'V');
+    Flags::Switch            sw  = Flags::flag(this, "switch", 'w');
+    Flags::Flag<vector<std::string_view>> rest = Flags::positional(this, "X");
+  };
+
+  /// Forwards whatever the test schema does not accept.
+  struct PassthroughFlags: TestSchemas::BasicFlags {
+    PassthroughFlags() { passUnknownFlags(); }
+  };
+
+  /// Discards everything written to it.
+  class NullBuffer: public std::streambuf {
+   protected:
+    int overflow(int c) override { return c; }
+  };
+
+  template<typename Schema>
+  static void parseWith(int argc, const char *const *argv) {
+    Schema flags;
+    flags.parseArgs(argc, argv);
+  }
+
+  /// Parses the given input against every schema and prints its help text.
+  static void exercise(const uint8_t *data, size_t size) {
+    vector<string> tokens(1, "flagsfuzz");
+    tokens.push_back(string());
+    for (size_t i = 0; i < size; ++i) {
+      if (data[i]) {
+        tokens.back() += char(data[i]);
+      } else {
+        tokens.push_back(string());
+      }
+    }
+    vector<const char*> argv;
+    for (const string &token : tokens) {
+      argv.push_back(token.c_str());
+    }
+    argv.push_back(nullptr);
+    const int argc = argv.size() - 1;
+
+    parseWith<ExampleSchema::AllFlags>(argc, argv.data());
+    parseWith<TestSchemas::BasicFlags>(argc, argv.data());
+    parseWith<TestSchemas::SequentialFlags>(argc, argv.data());
+    parseWith<PrimitiveFlags>(argc, argv.data());
+    parseWith<PassthroughFlags>(argc, argv.data());
+
+    NullBuffer nullBuffer;
+    std::ostream nullStream(&nullBuffer);
+    Flags::BasicHelpPrinter printer(nullStream);
+    printer.writeBlock(string(reinterpret_cast<const char*>(data), size));
+  }
+
+  /// Returns the fraction of its linear time budget an input has used.
+  static double budgetUse(std::chrono::steady_clock::duration elapsed,
+                          size_t size) {
+    double ns = std::chrono::duration<double, std::nano>(elapsed).count();
+    return ns / (kBaseBudgetNs + kBudgetNsPerByte * size);
+  }
+
+  /// Runs the given input once, returning the time it took.
+  static std::chrono::steady_clock::duration timeExercise(
+      const uint8_t *data, size_t size) {
+    auto start = std::chrono::steady_clock::now();
+    exercise(data, size);
+    return std::chrono::steady_clock::now() - start;
+  }
+
+  /// Tracks executions per second and the slowest input relative to budget.
+  class Throughput {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    Clock::time_point lastReport = start;
+    size_t execs = 0;
+    double worstBudgetUse = 0;
+
+   public:
+    /// Records one execution which used the given fraction of its budget.
+    void record(double budgetUsed) {
+      ++execs;
+      worstBudgetUse = std::max(worstBudgetUse, budgetUsed);
+
+      Clock::time_point now = Clock::now();
+      if (std::chrono::duration<double>(now - lastReport).count()
+              >= kReportInterval) {
+        double seconds = std::chrono::duration<double>(now - start).count();
+        fprintf(stderr, "flagsfuzz: %zu execs, %.0f execs/s, "
+            "slowest input used %.1f%% of its time budget\n",
+            execs, execs / seconds, worstBudgetUse * 100);
+        lastReport = now;
+      }
+    }
+  };
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  static FlagsFuzz::Throughput throughput;
+  double used = FlagsFuzz::budgetUse(FlagsFuzz::timeExercise(data, size), size);
+  if (used > 1) {
+    // Retry once, so one-time initialization and scheduling hiccups are not
+    // mistaken for slow inputs.
+    used = FlagsFuzz::budgetUse(FlagsFuzz::timeExercise(data, size), size);
+  }
+  throughput.record(used);
+  if (used > 1) {
+    fprintf(stderr, "flagsfuzz: input of %zu bytes took %.0f%% of its linear "
+        "time budget\n", size, used * 100);
+    abort();
+  }
+  return 0;
+}
+
+#ifdef DEEPFLAGS_FUZZ_STANDALONE
+#include <fstream>
+#include <iterator>
+#include <random>
+
+int main(int argc, char *argv[]) {
+  if (argc > 1) {
+    for (int i = 1; i < argc; ++i) {
+      std::ifstream file(argv[i], std::ios::binary);
+      vector<uint8_t> input((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+      LLVMFuzzerTestOneInput(input.data(), input.size());
+    }
+    return 0;
+  }
+
+  // Without a corpus, splice together fragments likely to reach deep paths.
+  static const char *const fragments[] = {
+    "--display", "-D", "--file", "-f", "a.txt", "-l", "--label=x", "-b", "-p",
+    "-pb", "-bp", "--bookmark=1", "--entity", "--id", "--id=", "--name=", "-x",
+    "-y", "--ind", "--ind=7", "--toggle", "--toggle2=1", "--alive=yes",
+    "--param", "--lists", "--weights", "--seq", "-r", "--rep=", "-w", "-s",
+    "--u8", "-5", "--i8=-129", "-1", "--ldouble", "0x1f", "-0", "1e999",
+    "nan", "010", "08", "--", "-", "", "=", "--=", "1", "2", "3", ".5", "-.5",
+    "--rng", "-R", "1-5,-3--1", "0-32767", "7,", "5-3",
+    "--tup", "-t", "--arr", "--opt", "-V", "255", "256",
+    "--bits", "yes", "OFF", "tRuE", "--map", "-m", "--flat", "a=1", "1=2",
+    "=", "1=", "k==v", "--list", "a:b", ":", "--interned",
+    "--stream", "1:2", "200:201", "--checked",
+    "--path", "/:/tmp", "/nonexistent",
+  };
+  constexpr size_t fragmentCount = sizeof(fragments) / sizeof(*fragments);
+  std::mt19937 rng(1337);
+  for (int run = 0; run < 200000; ++run) {
+    string input;
+    for (size_t n = rng() % 24; n; --n) {
+      if (rng() % 16) {
+        input += fragments[rng() % fragmentCount];
+      } else {
+        input += char(rng());
+      }
+      input += '\0';
+    }
+    if (!input.empty()) {
+      input.pop_back();
+    }
+    LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(input.data()),
+                           input.size());
+  }
+  return 0;
+}
+#endif
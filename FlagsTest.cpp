@@ -1,5 +1,16 @@
 #include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <random>
+#include <stdexcept>
+#include <sstream>
+#include <thread>
 #include "DeepFlags.hpp"
+#if defined(__unix__) || defined(__APPLE__)
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
 using std::vector;
 using std::string;
 
@@ -131,3 +142,1805 @@ namespace Test2 {
     ASSERT_EQ(1336, allFlags.param.value);
   }
 }
+
+namespace CapacityTest {
+
+  struct InnerGroup: Flags::FlagGroup {
+    Flags::Flag<int> a = Flags::flag(this, "a");
+    Flags::Switch b = Flags::flag(this, 'b');
+    InnerGroup(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct OuterGroup: Flags::FlagGroup {
+    Flags::Flag<InnerGroup> inner = Flags::flag(this, "inner");
+    OuterGroup(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct MyFlagGroup: Flags::FlagGroup {
+    Flags::Flag<vector<OuterGroup>> outers = Flags::flag(this, "outer");
+  };
+
+  TEST(FlagsTest, SaturatedGroupsStartNewElements) {
+    const char* argv[] = {
+      "flagstext.exe",
+      "--outer",
+        "--inner", "--a", "1",
+        "--inner", "-b",
+        "--inner", "--a", "2", "-b",
+        "--inner", "--a", "3"
+    };
+    constexpr size_t argc = sizeof(argv) / sizeof(const char*);
+
+    MyFlagGroup allFlags;
+    for (int pass = 0; pass < 2; ++pass) {
+      ASSERT_TRUE(allFlags.parseArgs(argc, argv));
+      ASSERT_EQ(3u, allFlags.outers.value.size());
+      EXPECT_EQ(1, allFlags.outers.value[0].inner.value.a.value);
+      EXPECT_TRUE(allFlags.outers.value[0].inner.value.b.present);
+      EXPECT_EQ(2, allFlags.outers.value[1].inner.value.a.value);
+      EXPECT_TRUE(allFlags.outers.value[1].inner.value.b.present);
+      EXPECT_EQ(3, allFlags.outers.value[2].inner.value.a.value);
+      EXPECT_FALSE(allFlags.outers.value[2].inner.value.b.present);
+      allFlags.reset();
+    }
+  }
+}
+
+namespace ConversionTest {
+
+  struct MyFlagGroup: Flags::FlagGroup {
+    Flags::Flag<Flags::Sequential<double>> weights =
+        Flags::flag(this, "weights");
+    Flags::Flag<int> param = Flags::flag(this, "param");
+  };
+
+  /// Builds "--weights 0.5 1.5 2.5 ..." followed by "--param 7".
+  struct WeightArgs {
+    vector<string> args;
+    vector<const char*> argv;
+
+    WeightArgs(size_t count) {
+      args.push_back("flagstest.exe");
+      args.push_back("--weights");
+      for (size_t i = 0; i < count; ++i) {
+        args.push_back(std::to_string(i) + ".5");
+      }
+      args.push_back("--param");
+      args.push_back("7");
+    }
+
+    const char* const* data() {
+      argv.clear();
+      for (const string &arg : args) {
+        argv.push_back(arg.c_str());
+      }
+      return argv.data();
+    }
+  };
+
+  TEST(FlagsTest, LongValueRunsConvertInOrder) {
+    constexpr size_t count = 4 * DEEPFLAGS_PARALLEL_MIN_VALUES + 3;
+    WeightArgs args(count);
+    MyFlagGroup allFlags;
+    ASSERT_TRUE(allFlags.parseArgs(args.args.size(), args.data()));
+    ASSERT_EQ(count, allFlags.weights.value.size());
+    for (size_t i = 0; i < count; ++i) {
+      ASSERT_EQ(i + .5, allFlags.weights.value[i]) << "at index " << i;
+    }
+    ASSERT_EQ(7, allFlags.param.value);
+  }
+
+  TEST(FlagsTest, LongValueRunsStopAtFirstBadValue) {
+    constexpr size_t count = 4 * DEEPFLAGS_PARALLEL_MIN_VALUES;
+    WeightArgs args(count);
+    args.args[2 + count - 5] = "bad";
+    args.args[2 + count / 2] = "bad";
+    args.args[2 + 12345] = "bad";
+    MyFlagGroup allFlags;
+    ASSERT_FALSE(allFlags.parseArgs(args.args.size(), args.data()));
+    ASSERT_EQ(12345u, allFlags.weights.value.size());
+    EXPECT_EQ(12344.5, allFlags.weights.value.back());
+  }
+
+  TEST(FlagsTest, ChunkedConversionReportsFirstFailure) {
+    vector<std::string_view> raw(1000, "42");
+    raw[999] = "x";
+    raw[600] = "-";
+    raw[250] = "4 2";
+    for (unsigned chunks = 1; chunks <= 16; ++chunks) {
+      vector<int> out(raw.size());
+      EXPECT_EQ(250u, Flags::Internal::convertValues(
+          raw.data(), out.data(), raw.size(), chunks)) << chunks << " chunks";
+      EXPECT_EQ(42, out[249]);
+    }
+    raw.resize(250);
+    vector<int> out(raw.size());
+    EXPECT_EQ(250u, Flags::Internal::convertValues(
+        raw.data(), out.data(), raw.size(), 7));
+  }
+}
+
+namespace DigitsTest {
+  using Flags::Internal::Digits::Block;
+
+  /// Random tokens: mostly plain decimals, plus signs, octal, hex and junk.
+  static vector<string> randomTokens(size_t count) {
+    static const char *const specials[] = {
+      "0", "-0", "+0", "00", "08", "010", "0x1F", "-0x10", "", "-", "+", "1-",
+      "12a", " 1", "1 ", "9999999999999999", "10000000000000000",
+      "-9223372036854775808", "9223372036854775807", "9223372036854775808",
+      "18446744073709551615", "2147483648", "-2147483649", "4294967296",
+      "1/2", "1:2",
+    };
+    std::mt19937_64 rng(56);
+    vector<string> res;
+    for (size_t i = 0; i < count; ++i) {
+      if (rng() % 8 == 0) {
+        res.push_back(specials[rng() % (sizeof(specials) / sizeof(*specials))]);
+        continue;
+      }
+      string token = std::to_string(rng() >> (rng() % 64));
+      if (rng() % 4 == 0) {
+        token = "-" + token;
+      }
+      res.push_back(token);
+    }
+    return res;
+  }
+
+  template<typename T> void expectBatchMatchesScalar() {
+    vector<string> tokens = randomTokens(5000);
+    vector<std::string_view> raw(tokens.begin(), tokens.end());
+    for (size_t i = 0; i < raw.size(); ++i) {
+      T scalar = 0, batch = 0;
+      bool scalarOk = Flags::Internal::parseInteger(raw[i], scalar);
+      size_t res = Flags::Internal::convertIntegers(&raw[i], &batch, 0, 1, 1);
+      ASSERT_EQ(scalarOk, res == 1) << "\"" << tokens[i] << "\"";
+      if (scalarOk) {
+        ASSERT_EQ(scalar, batch) << "\"" << tokens[i] << "\"";
+      }
+    }
+
+    // Converting everything at once must stop at the first failure.
+    vector<T> out(raw.size());
+    size_t firstBad = Flags::Internal::convertIntegers(
+        raw.data(), out.data(), 0, raw.size(), raw.size());
+    for (size_t i = 0; i < firstBad; ++i) {
+      T scalar = 0;
+      ASSERT_TRUE(Flags::Internal::parseInteger(raw[i], scalar));
+      ASSERT_EQ(scalar, out[i]);
+    }
+    if (firstBad < raw.size()) {
+      T scalar;
+      EXPECT_FALSE(Flags::Internal::parseInteger(raw[firstBad], scalar));
+    }
+  }
+
+  TEST(FlagsTest, BatchIntegerConversionMatchesScalar) {
+    expectBatchMatchesScalar<int8_t>();
+    expectBatchMatchesScalar<int32_t>();
+    expectBatchMatchesScalar<int64_t>();
+    expectBatchMatchesScalar<uint16_t>();
+    expectBatchMatchesScalar<uint64_t>();
+  }
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) \
+    && !defined(DEEPFLAGS_NO_SIMD)
+  TEST(FlagsTest, VectorDigitKernelsMatchScalar) {
+    std::mt19937 rng(16);
+    vector<Block> blocks(1001);
+    for (Block &block : blocks) {
+      for (char &c : block.digits) {
+        c = rng() % 32 ? '0' + rng() % 10 : char(rng());
+      }
+    }
+    vector<uint64_t> expected(blocks.size()), actual(blocks.size());
+    Flags::Internal::Digits::convertScalar(
+        blocks.data(), expected.data(), blocks.size());
+    if (__builtin_cpu_supports("sse4.1")) {
+      Flags::Internal::Digits::convertSse41(
+          blocks.data(), actual.data(), blocks.size());
+      EXPECT_EQ(expected, actual);
+    }
+    if (__builtin_cpu_supports("avx2")) {
+      Flags::Internal::Digits::convertAvx2(
+          blocks.data(), actual.data(), blocks.size());
+      EXPECT_EQ(expected, actual);
+    }
+  }
+#endif
+}
+
+namespace SplitTest {
+
+  struct MyFlagGroup: Flags::FlagGroup {
+    Flags::Flag<vector<int>> inds = Flags::flag(this, "ind").splitOn(',');
+    Flags::Flag<vector<string>> names =
+        Flags::flag(this, "names", 'n').splitOn(':');
+    Flags::Flag<int> param = Flags::flag(this, "param");
+  };
+
+  TEST(FlagsTest, SplitValuesExpandIntoElements) {
+    const char* argv[] = {
+      "flagstest.exe",
+      "--ind=1,2,3,4",
+      "--names", "a:bc::d", "e",
+      "--param", "7",
+      "--ind", "5", "6,-7"
+    };
+    constexpr size_t argc = sizeof(argv) / sizeof(const char*);
+    MyFlagGroup allFlags;
+    ASSERT_TRUE(allFlags.parseArgs(argc, argv));
+    EXPECT_EQ(vector<int>({ 1, 2, 3, 4, 5, 6, -7 }), allFlags.inds.value);
+    EXPECT_EQ(vector<string>({ "a", "bc", "", "d", "e" }),
+              allFlags.names.value);
+    EXPECT_EQ(7, allFlags.param.value);
+  }
+
+  TEST(FlagsTest, SplitValuesRejectEmptyNumbers) {
+    const char* argv[] = { "flagstest.exe", "--ind=1,2,,4" };
+    MyFlagGroup allFlags;
+    ASSERT_FALSE(allFlags.parseArgs(2, argv));
+    EXPECT_EQ(vector<int>({ 1, 2 }), allFlags.inds.value);
+  }
+
+  struct SingleValueFlags: Flags::FlagGroup {
+    Flags::Flag<int> param = Flags::flag(this, "param").splitOn(',');
+  };
+
+  TEST(FlagsTest, SplitOnSingleValueIsRejected) {
+    testing::internal::CaptureStderr();
+    SingleValueFlags flags;
+    EXPECT_EQ("Internal error: flag \"param\" does not support splitOn()\n",
+              testing::internal::GetCapturedStderr());
+    const char* argv[] = { "flagstest.exe", "--param", "7" };
+    EXPECT_FALSE(flags.parseArgs(3, argv));
+  }
+
+  TEST(FlagsTest, SplitFindsEveryDelimiter) {
+    // Cover delimiters on either side of each sixteen-character boundary.
+    for (size_t length = 0; length < 70; ++length) {
+      for (size_t stride = 1; stride < 20; ++stride) {
+        string text(length, 'x');
+        vector<std::string_view> expected;
+        size_t start = 0;
+        for (size_t i = stride - 1; i < length; i += stride) {
+          text[i] = ',';
+          expected.push_back(std::string_view(text).substr(start, i - start));
+          start = i + 1;
+        }
+        expected.push_back(std::string_view(text).substr(start));
+        
+        vector<std::string_view> pieces;
+        Flags::Internal::splitValue(text, ',', pieces);
+        EXPECT_EQ(expected, pieces) << "\"" << text << "\"";
+      }
+    }
+  }
+}
+
+namespace RangesTest {
+
+  struct MyFlagGroup: Flags::FlagGroup {
+    Flags::Flag<Flags::IntRanges<int>> shards = Flags::flag(this, "shards");
+    Flags::Flag<Flags::IntRanges<int8_t>> levels = Flags::flag(this, "levels");
+  };
+
+  TEST(FlagsTest, IntRangesParseAndMerge) {
+    const char* argv[] = {
+      "flagstest.exe",
+      "--shards", "200000-299999,0-99999,100000,7,-5--3",
+      "--levels=-128-127"
+    };
+    constexpr size_t argc = sizeof(argv) / sizeof(const char*);
+    MyFlagGroup allFlags;
+    ASSERT_TRUE(allFlags.parseArgs(argc, argv));
+    
+    typedef Flags::IntRanges<int>::Interval Interval;
+    EXPECT_EQ(vector<Interval>({ Interval(-5, -3), Interval(0, 100000),
+                                 Interval(200000, 299999) }),
+              allFlags.shards.value.intervals());
+    EXPECT_EQ(3u + 100001u + 100000u, allFlags.shards.value.size());
+    EXPECT_TRUE(allFlags.shards.value.contains(-4));
+    EXPECT_TRUE(allFlags.shards.value.contains(100000));
+    EXPECT_FALSE(allFlags.shards.value.contains(100001));
+    EXPECT_FALSE(allFlags.shards.value.contains(-2));
+    EXPECT_TRUE(allFlags.shards.value.contains(299999));
+    EXPECT_FALSE(allFlags.shards.value.contains(300000));
+    
+    EXPECT_EQ(256u, allFlags.levels.value.size());
+    vector<int8_t> levels = allFlags.levels.value.toVector();
+    ASSERT_EQ(256u, levels.size());
+    EXPECT_EQ(-128, levels.front());
+    EXPECT_EQ(127, levels.back());
+  }
+
+  TEST(FlagsTest, IntRangesIterateInOrder) {
+    Flags::IntRanges<int> ranges;
+    ranges.insert(10, 12);
+    ranges.insert(1, 2);
+    ranges.insert(4, 4);
+    ranges.insert(3, 3);
+    vector<int> visited(ranges.begin(), ranges.end());
+    EXPECT_EQ(vector<int>({ 1, 2, 3, 4, 10, 11, 12 }), visited);
+    EXPECT_EQ(visited, ranges.toVector());
+    EXPECT_EQ(2u, ranges.intervals().size());
+  }
+
+  TEST(FlagsTest, IntRangesRejectBadRanges) {
+    for (const char *bad : { "5-3", "1,,2", "1-", "-", "1-2-3", "x", "300" }) {
+      const char* argv[] = { "flagstest.exe", "--levels", bad };
+      MyFlagGroup allFlags;
+      EXPECT_FALSE(allFlags.parseArgs(3, argv)) << bad;
+    }
+  }
+}
+
+#ifdef DEEPFLAGS_INCREMENTAL
+namespace IncrementalTest {
+
+  struct EntityFlags: Flags::FlagGroup {
+    Flags::Flag<int64_t> id = Flags::flag(this, "id");
+    Flags::Flag<string>  name = Flags::flag(this, "name");
+    Flags::Flag<double>  x = Flags::flag(this, "x", 'x');
+    EntityFlags(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct MyFlagGroup: Flags::FlagGroup {
+    Flags::Flag<int64_t> param = Flags::flag(this, "param");
+    Flags::Flag<vector<EntityFlags>> entities = Flags::flag(this, "entity");
+    Flags::Flag<vector<int>> inds = Flags::flag(this, "ind");
+    Flags::Switch toggle = Flags::flag(this, "toggle", 't');
+  };
+
+  TEST(FlagsTest, IncrementalParsingMatchesBatchParsing) {
+    const vector<string> args = {
+      "--entity", "--id", "1", "--name", "first", "-x", "1.5",
+      "--ind", "1", "2", "3",
+      "--entity", "--id=2", "-x", "2.5",
+      "-t", "--param", "20", "--ind=4", "5",
+    };
+    
+    MyFlagGroup fed;
+    Flags::IncrementalParser parser(fed);
+    for (const string &arg : args) {
+      parser.feed(arg);
+      // The parser can never finish early, as more values could follow.
+      ASSERT_FALSE(parser.done()) << "after " << arg;
+    }
+    ASSERT_TRUE(parser.finish());
+    EXPECT_TRUE(parser.succeeded());
+    
+    vector<const char*> argv = { "flagstest.exe" };
+    for (const string &arg : args) {
+      argv.push_back(arg.c_str());
+    }
+    MyFlagGroup batch;
+    ASSERT_TRUE(batch.parseArgs(argv.size(), argv.data()));
+    
+    EXPECT_EQ(batch.param.value, fed.param.value);
+    EXPECT_EQ(batch.inds.value, fed.inds.value);
+    EXPECT_EQ(vector<int>({ 1, 2, 3, 4, 5 }), fed.inds.value);
+    EXPECT_TRUE(fed.toggle.present);
+    ASSERT_EQ(2u, fed.entities.value.size());
+    EXPECT_EQ(1, fed.entities.value[0].id.value);
+    EXPECT_EQ("first", fed.entities.value[0].name.value);
+    EXPECT_EQ(1.5, fed.entities.value[0].x.value);
+    EXPECT_EQ(2, fed.entities.value[1].id.value);
+    EXPECT_EQ(2.5, fed.entities.value[1].x.value);
+  }
+
+  TEST(FlagsTest, IncrementalParsingStopsAtFirstError) {
+    MyFlagGroup fed;
+    Flags::IncrementalParser parser(fed);
+    parser.feed("--param");
+    EXPECT_FALSE(parser.done());
+    parser.feed("twenty");
+    EXPECT_TRUE(parser.done());
+    EXPECT_FALSE(parser.succeeded());
+    parser.feed("--toggle");
+    EXPECT_FALSE(parser.finish());
+    EXPECT_FALSE(fed.toggle.present);
+  }
+
+  TEST(FlagsTest, IncrementalParsingOfNothingSucceeds) {
+    MyFlagGroup fed;
+    Flags::IncrementalParser parser(fed);
+    EXPECT_TRUE(parser.finish());
+    EXPECT_TRUE(parser.done());
+  }
+
+  TEST(FlagsTest, AbandonedIncrementalParserUnwinds) {
+    MyFlagGroup fed;
+    {
+      Flags::IncrementalParser parser(fed);
+      parser.feed("--entity");
+      parser.feed("--name");
+      parser.feed("nested");
+      parser.feed("--ind");
+      parser.feed("7");
+    }
+    EXPECT_EQ(vector<int>({ 7 }), fed.inds.value);
+    ASSERT_EQ(1u, fed.entities.value.size());
+    EXPECT_EQ("nested", fed.entities.value[0].name.value);
+  }
+
+#ifndef DEEPFLAGS_NO_REGEX
+  struct PatternFlags: Flags::FlagGroup {
+    Flags::Flag<string> name = Flags::flag(this, "name").matches("(a|b)*");
+  };
+
+  TEST(FlagsTest, IncrementalParserFitsRecursiveMatches) {
+    // libstdc++ recurses once per character matched by a repeated group.
+    string value;
+    for (int i = 0; i < 4000; i++) {
+      value += "ab"[i % 2];
+    }
+    PatternFlags fed;
+    Flags::IncrementalParser parser(fed);
+    parser.feed("--name");
+    parser.feed(value);
+    ASSERT_TRUE(parser.finish());
+    EXPECT_EQ(value, fed.name.value);
+  }
+#endif
+
+  struct HandledFlags: Flags::FlagGroup {
+    Flags::Flag<Flags::Stream<int>> sizes = Flags::flag(this, "size");
+    Flags::Switch toggle = Flags::flag(this, "toggle", 't');
+  };
+
+  TEST(FlagsTest, IncrementalParserRethrowsToCaller) {
+    HandledFlags fed;
+    fed.sizes.onValue([](int size) {
+      if (size > 100) {
+        throw std::invalid_argument("size too large");
+      }
+    });
+    Flags::IncrementalParser parser(fed);
+    parser.feed("--size");
+    parser.feed("1");
+    EXPECT_THROW(parser.feed("200"), std::invalid_argument);
+    EXPECT_TRUE(parser.done());
+    EXPECT_FALSE(parser.succeeded());
+    // The parser has stopped, so later arguments are ignored.
+    parser.feed("-t");
+    EXPECT_FALSE(parser.finish());
+    EXPECT_FALSE(fed.toggle.present);
+  }
+}
+#endif
+
+namespace CommandTest {
+
+  static vector<string> split(const char *line) {
+    Flags::CommandSplitter splitter;
+    EXPECT_TRUE(splitter.split(line)) << line;
+    EXPECT_EQ(nullptr, splitter.argv()[splitter.argc()]);
+    return vector<string>(splitter.argv(), splitter.argv() + splitter.argc());
+  }
+
+  TEST(FlagsTest, CommandSplittingFollowsShellQuoting) {
+    EXPECT_EQ(vector<string>({ "prog", "--label", "File 1", "-b", "1", "3" }),
+              split("prog --label \"File 1\" -b 1 3"));
+    EXPECT_EQ(vector<string>({ "a b", "c\"d", "$x", "e\\f", "" }),
+              split("  'a b'\tc\\\"d \"\\$x\" \"e\\f\" '' "));
+    EXPECT_EQ(vector<string>({ "ab", "c#d" }), split("a\\\nb c#d # e f"));
+    EXPECT_EQ(vector<string>({ "it's", "x y" }), split("it\\'s x\\ y"));
+    EXPECT_EQ(vector<string>(), split("   # nothing"));
+    
+    Flags::CommandSplitter splitter;
+    EXPECT_FALSE(splitter.split("'open"));
+    EXPECT_FALSE(splitter.split("\"open\\\""));
+    EXPECT_FALSE(splitter.split("trailing\\"));
+    ASSERT_TRUE(splitter.split("--name=x", "prog"));
+    ASSERT_EQ(2, splitter.argc());
+    EXPECT_STREQ("prog", splitter.argv()[0]);
+  }
+
+  struct DisplayFlags: Flags::FlagGroup {
+    Flags::Flag<string> file = Flags::flag(this, "file", 'f');
+    Flags::Flag<string> label = Flags::flag(this, "label", 'l');
+    Flags::Flag<vector<int>> bookmarks = Flags::flag(this, "bookmark", 'b');
+  };
+
+  struct QuitFlags: Flags::FlagGroup {
+    Flags::Switch now = Flags::flag(this, "now");
+  };
+
+  TEST(FlagsTest, CommandLoopDispatchesEachLine) {
+    DisplayFlags display;
+    QuitFlags quit;
+    vector<string> shown;
+    Flags::CommandLoop loop;
+    loop.on("display", display, [&](DisplayFlags &flags) {
+      EXPECT_EQ(&display, &flags);
+      string entry = flags.file.value + "/" + flags.label.value;
+      for (int bookmark : flags.bookmarks.value) {
+        entry += " " + std::to_string(bookmark);
+      }
+      shown.push_back(entry);
+    });
+    loop.on("quit", quit, [&](QuitFlags &flags) {
+      EXPECT_TRUE(flags.now.present);
+      loop.stop();
+    });
+    
+    std::istringstream in(
+        "display -f a.txt -l 'File 1' -b 1 3\n"
+        "\n"
+        "# comments are skipped\n"
+        "display --file b.txt -b 7\n"
+        "bogus --file c.txt\n"
+        "display --nonsense\n"
+        "display -f d.txt\n"
+        "quit --now\n"
+        "display -f never.txt\n");
+    EXPECT_EQ(2u, loop.run(in));
+    EXPECT_EQ(vector<string>({ "a.txt/File 1 1 3", "b.txt/ 7", "d.txt/" }),
+              shown);
+  }
+
+  TEST(FlagsTest, CommandLoopWithoutCommandWords) {
+    DisplayFlags display;
+    size_t handled = 0;
+    Flags::CommandLoop loop;
+    loop.on("", display, [&](DisplayFlags &flags) {
+      EXPECT_EQ("x.txt", flags.file.value);
+      ++handled;
+    });
+    EXPECT_TRUE(loop.handleLine("-f x.txt -b 1"));
+    EXPECT_TRUE(loop.handleLine("--file=x.txt"));
+    EXPECT_FALSE(loop.handleLine("-f x.txt --bogus"));
+    EXPECT_EQ(2u, handled);
+  }
+}
+
+namespace SplitterTest {
+
+  /// Splits a line one character at a time, as a reference.
+  static bool referenceSplit(const string &line, vector<string> &out) {
+    out.clear();
+    size_t i = 0;
+    auto blank = [&](size_t at) {
+      return line[at] == ' ' || line[at] == '\t' || line[at] == '\n'
+          || line[at] == '\r';
+    };
+    for (;;) {
+      while (i < line.size() && blank(i)) {
+        ++i;
+      }
+      if (i >= line.size() || line[i] == '#') {
+        return true;
+      }
+      string arg;
+      while (i < line.size() && !blank(i)) {
+        char c = line[i++];
+        if (c == '\'') {
+          size_t end = line.find('\'', i);
+          if (end == string::npos) {
+            return false;
+          }
+          arg += line.substr(i, end - i);
+          i = end + 1;
+        } else if (c == '"') {
+          for (;;) {
+            if (i >= line.size()) {
+              return false;
+            }
+            char q = line[i++];
+            if (q == '"') {
+              break;
+            }
+            if (q == '\\' && i < line.size()
+                && string("\"\\$`\n").find(line[i]) != string::npos) {
+              q = line[i++];
+              if (q == '\n') {
+                continue;
+              }
+            }
+            arg += q;
+          }
+        } else if (c == '\\') {
+          if (i >= line.size()) {
+            return false;
+          }
+          if (line[i] != '\n') {
+            arg += line[i];
+          }
+          ++i;
+        } else {
+          arg += c;
+        }
+      }
+      out.push_back(arg);
+    }
+  }
+
+  TEST(FlagsTest, CommandSplittingMatchesReference) {
+    // Mostly plain text, so that vector scans cover long stretches.
+    static const char alphabet[] =
+        "abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz0123456789-=/."
+        "      \t\n\r'\"\\\\#$`\x01\x7f\xe9";
+    std::mt19937 rng(61);
+    Flags::CommandSplitter splitter;
+    vector<string> expected;
+    for (int run = 0; run < 20000; ++run) {
+      string line;
+      for (size_t n = rng() % 80; n; --n) {
+        line += alphabet[rng() % (sizeof(alphabet) - 1)];
+      }
+      bool valid = referenceSplit(line, expected);
+      ASSERT_EQ(valid, splitter.split(line)) << line;
+      if (valid) {
+        ASSERT_EQ(expected, vector<string>(splitter.argv(),
+            splitter.argv() + splitter.argc())) << line;
+      }
+    }
+  }
+
+  TEST(FlagsTest, SplitInPlaceFeedsParseArgs) {
+    struct DisplayFile: Flags::FlagGroup {
+      Flags::Flag<string> label = Flags::flag(this, "label", 'l');
+      Flags::Flag<vector<int>> bookmarks = Flags::flag(this, "bookmark", 'b');
+    } flags;
+    string line = "prog --label \"File 1\" -b 1 3";
+    const char *const source = line.data();
+    Flags::CommandSplitter splitter;
+    ASSERT_TRUE(splitter.splitInPlace(line));
+    ASSERT_EQ(6, splitter.argc());
+    EXPECT_EQ(source, splitter.argv()[0]);
+    EXPECT_EQ(source + 5, splitter.argv()[1]);
+    ASSERT_TRUE(flags.parseArgs(splitter.argc(), splitter.argv()));
+    EXPECT_EQ("File 1", flags.label.value);
+    EXPECT_EQ(vector<int>({ 1, 3 }), flags.bookmarks.value);
+  }
+}
+
+namespace ConstraintTest {
+
+  struct DisplayFile: Flags::FlagGroup {
+    Flags::Flag<string> file = Flags::flag(this, "file", 'f');
+    Flags::Switch readStdin = Flags::flag(this, "stdin");
+    Flags::Flag<string> label = Flags::flag(this, "label", 'l').required();
+    Flags::Switch createIfMissing = Flags::flag(this, 'p');
+    Flags::Switch quiet = Flags::flag(this, 'q');
+    DisplayFile(CtorArgs args): FlagGroup(args) {
+      mutuallyExclusive({ &file, &readStdin });
+      requireOneOf({ &file, &readStdin });
+      dependsOn(createIfMissing, { &file });
+    }
+  };
+
+  struct AllFlags: Flags::FlagGroup {
+    Flags::Flag<Flags::Repeated<DisplayFile>> files =
+        Flags::flag(this, "display", 'D');
+    Flags::Switch verbose = Flags::flag(this, 'v');
+    Flags::Switch quiet = Flags::flag(this, 'q');
+    AllFlags() {
+      mutuallyExclusive({ &verbose, &quiet });
+    }
+  };
+
+  static bool parse(std::initializer_list<const char*> args) {
+    vector<const char*> argv = { "flagstest.exe" };
+    argv.insert(argv.end(), args);
+    AllFlags flags;
+    return flags.parseArgs(argv.size(), argv.data());
+  }
+
+  TEST(FlagsTest, ConstraintsAcceptValidCombinations) {
+    EXPECT_TRUE(parse({ "-D", "-f", "a.txt", "-l", "A", "-p",
+                        "-D", "--stdin", "-l", "B", "-q" }));
+    EXPECT_TRUE(parse({ "-v" }));
+    EXPECT_TRUE(parse({}));
+  }
+
+  TEST(FlagsTest, ConstraintsRejectInvalidCombinations) {
+    // Exclusive within an element, and at the top level.
+    EXPECT_FALSE(parse({ "-D", "-f", "a.txt", "--stdin", "-l", "A" }));
+    EXPECT_FALSE(parse({ "-v", "-q" }));
+    // Neither source given.
+    EXPECT_FALSE(parse({ "-D", "-l", "A" }));
+    // Missing required label.
+    EXPECT_FALSE(parse({ "-D", "-f", "a.txt" }));
+    // -p without --file, in the second element.
+    EXPECT_FALSE(parse({ "-D", "-f", "a.txt", "-l", "A",
+                         "-D", "--stdin", "-pl", "B" }));
+  }
+
+  struct StrayConstraint: Flags::FlagGroup {
+    Flags::Switch inside = Flags::flag(this, 'a');
+    Flags::Switch outside = Flags::flag(nullptr, 'b');
+    StrayConstraint() {
+      mutuallyExclusive({ &inside, &outside });
+    }
+  };
+
+  TEST(FlagsTest, ConstraintOnNonMemberFailsEveryParse) {
+    testing::internal::CaptureStderr();
+    StrayConstraint flags;
+    EXPECT_EQ("Internal error: constraint names 'b', which is not a member "
+              "of this group\n", testing::internal::GetCapturedStderr());
+    const char *argv[] = { "flagstest.exe", "-a" };
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(flags.parseArgs(2, argv));
+    EXPECT_EQ("A flag group was declared incorrectly\n",
+              testing::internal::GetCapturedStderr());
+  }
+
+  struct NeedsFile: Flags::FlagGroup {
+    Flags::Flag<string> file = Flags::flag(this, "file").required();
+  };
+
+  TEST(FlagsTest, ConstraintsApplyToEmptyArguments) {
+    const char *argv[] = { "flagstest.exe" };
+    EXPECT_FALSE(NeedsFile().parseArgs(1, argv));
+    DisplayFile display(Flags::flag(nullptr, "display"));
+    EXPECT_FALSE(display.parseArgs(1, argv));
+#ifdef DEEPFLAGS_INCREMENTAL
+    NeedsFile fed;
+    Flags::IncrementalParser parser(fed);
+    EXPECT_FALSE(parser.finish());
+#endif
+  }
+
+  /// A group with more members than fit in one word of presence bits.
+  struct WideGroup: Flags::FlagGroup {
+    std::deque<Flags::Switch> members;
+    WideGroup() {
+      for (int i = 0; i < 150; ++i) {
+        members.emplace_back(Flags::flag(this, "w" + std::to_string(i)));
+      }
+      mutuallyExclusive({ &members[3], &members[140] });
+      dependsOn(members[70], { &members[10], &members[130] });
+    }
+  };
+
+  TEST(FlagsTest, ConstraintsSpanManyMembers) {
+    const char *exclusive[] = { "flagstest.exe", "--w3", "--w140" };
+    const char *missing[] = { "flagstest.exe", "--w70", "--w10", "--w3" };
+    const char *present[] = { "flagstest.exe", "--w70", "--w10", "--w130" };
+    EXPECT_FALSE(WideGroup().parseArgs(3, exclusive));
+    EXPECT_FALSE(WideGroup().parseArgs(4, missing));
+    EXPECT_TRUE(WideGroup().parseArgs(4, present));
+  }
+}
+
+#ifndef DEEPFLAGS_NO_REGEX
+namespace ValidatorTest {
+
+  struct EntityFlags: Flags::FlagGroup {
+    Flags::Flag<string> name =
+        Flags::flag(this, "name").matches("[a-z][a-z0-9_]*");
+    Flags::Flag<vector<int>> weights =
+        Flags::flag(this, "weights", 'w').range(0, 100);
+    EntityFlags(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct MyFlagGroup: Flags::FlagGroup {
+    Flags::Flag<double> ratio = Flags::flag(this, "ratio").range(0.0, 1.0);
+    Flags::Flag<string> color =
+        Flags::flag(this, "color").oneOf({ "red", "green", "blue" });
+    Flags::Flag<vector<int>> sizes =
+        Flags::flag(this, "size").oneOf({ 1, 2, 4, 8 }).splitOn(',');
+    Flags::Flag<Flags::Repeated<EntityFlags>> entities =
+        Flags::flag(this, "entity");
+  };
+
+  static bool parse(std::initializer_list<const char*> args,
+                    MyFlagGroup &flags) {
+    vector<const char*> argv = { "flagstest.exe" };
+    argv.insert(argv.end(), args);
+    return flags.parseArgs(argv.size(), argv.data());
+  }
+
+  TEST(FlagsTest, ValidatorsAcceptGoodValues) {
+    MyFlagGroup flags;
+    ASSERT_TRUE(parse({ "--ratio=0.25", "--color", "green", "--size=1,8,2",
+                        "--entity", "--name", "first_1", "-w", "0", "50",
+                        "--entity", "--name=second", "-w", "100" }, flags));
+    EXPECT_EQ(0.25, flags.ratio.value);
+    EXPECT_EQ("green", flags.color.value);
+    EXPECT_EQ(vector<int>({ 1, 8, 2 }), flags.sizes.value);
+    ASSERT_EQ(2u, flags.entities.value.size());
+    EXPECT_EQ(vector<int>({ 0, 50 }), flags.entities.value[0].weights.value);
+  }
+
+  TEST(FlagsTest, ValidatorsRejectBadValues) {
+    for (auto args : {
+        std::initializer_list<const char*> { "--ratio=1.5" },
+        std::initializer_list<const char*> { "--ratio=nan" },
+        std::initializer_list<const char*> { "--color", "Red" },
+        std::initializer_list<const char*> { "--size=1,3,4" },
+        std::initializer_list<const char*> { "--entity", "--name", "1st" },
+        std::initializer_list<const char*> { "--entity", "--name", "a",
+                                             "--entity", "--name", "B" },
+    }) {
+      MyFlagGroup flags;
+      EXPECT_FALSE(parse(args, flags)) << *args.begin();
+    }
+  }
+
+  struct BadRangeFlags: Flags::FlagGroup {
+    Flags::Flag<int> level = Flags::flag(this, "level").range("low", "10");
+    Flags::Switch verbose = Flags::flag(this, 'v');
+  };
+
+  TEST(FlagsTest, UnparsableBoundsFailEveryParse) {
+    testing::internal::CaptureStderr();
+    BadRangeFlags flags;
+    EXPECT_EQ("Internal error: flag \"level\" cannot accept its own "
+              "restriction \"low\"\n",
+              testing::internal::GetCapturedStderr());
+
+    const char *without[] = { "flagstest.exe", "-v" };
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(flags.parseArgs(2, without));
+    EXPECT_EQ("Flag \"level\" was declared incorrectly\n",
+              testing::internal::GetCapturedStderr());
+
+    const char *with[] = { "flagstest.exe", "--level", "5" };
+    flags.reset();
+    EXPECT_FALSE(flags.parseArgs(3, with));
+  }
+
+  TEST(FlagsTest, RangeChecksWholeRunsOfValues) {
+    vector<string> args = { "flagstest.exe", "--entity", "-w" };
+    for (int i = 0; i < 1000; ++i) {
+      args.push_back(std::to_string(i % 101));
+    }
+    args[3 + 777] = "101";
+    args[3 + 900] = "-1";
+    vector<const char*> argv;
+    for (const string &arg : args) {
+      argv.push_back(arg.c_str());
+    }
+    MyFlagGroup flags;
+    ASSERT_FALSE(flags.parseArgs(argv.size(), argv.data()));
+    EXPECT_TRUE(flags.entities.value.empty());
+  }
+}
+#endif
+
+namespace PositionalTest {
+
+  struct ToolFlags: Flags::FlagGroup {
+    Flags::Flag<string> input = Flags::positional(this, "INPUT");
+    Flags::Flag<string> output = Flags::positional(this, "OUTPUT");
+    Flags::Flag<double> x = Flags::flag(this, "x", 'x');
+  };
+
+  struct ListFlags: Flags::FlagGroup {
+    Flags::Flag<vector<std::string_view>> files =
+        Flags::positional(this, "FILE");
+    Flags::Switch verbose = Flags::flag(this, "verbose", 'v');
+  };
+
+  struct PlainFlags: Flags::FlagGroup {
+    Flags::Flag<int> level = Flags::flag(this, "level");
+  };
+
+  TEST(FlagsTest, PositionalsTakeBareValuesInOrder) {
+    const char *argv[] = { "tool", "in.txt", "--x", "3", "out.txt" };
+    ToolFlags flags;
+    ASSERT_TRUE(flags.parseArgs(5, argv));
+    EXPECT_EQ("in.txt", flags.input.value);
+    EXPECT_EQ("out.txt", flags.output.value);
+    EXPECT_EQ(3, flags.x.value);
+
+    const char *extra[] = { "tool", "a", "b", "c" };
+    ToolFlags tooMany;
+    EXPECT_FALSE(tooMany.parseArgs(4, extra));
+  }
+
+  TEST(FlagsTest, PositionalListViewsArgv) {
+    const char *argv[] = { "tool", "a.txt", "b.txt", "-v", "c.txt" };
+    ListFlags flags;
+    ASSERT_TRUE(flags.parseArgs(5, argv));
+    ASSERT_EQ(3u, flags.files.value.size());
+    EXPECT_EQ(argv[1], flags.files.value[0].data());
+    EXPECT_EQ(argv[2], flags.files.value[1].data());
+    EXPECT_EQ(argv[4], flags.files.value[2].data());
+    EXPECT_TRUE(flags.verbose.present);
+  }
+
+  TEST(FlagsTest, DoubleDashEndsOptions) {
+    const char *argv[] = { "tool", "-v", "--", "-v", "--x" };
+    ListFlags flags;
+    ASSERT_TRUE(flags.parseArgs(5, argv));
+    EXPECT_EQ(vector<std::string_view>({ "-v", "--x" }), flags.files.value);
+    EXPECT_TRUE(flags.remainingArgs().empty());
+  }
+
+  TEST(FlagsTest, RemainingArgsFollowDoubleDash) {
+    const char *argv[] = { "tool", "in", "out", "--", "child", "--x", "1" };
+    ToolFlags flags;
+    ASSERT_TRUE(flags.parseArgs(7, argv));
+    EXPECT_EQ("out", flags.output.value);
+    const Flags::ArgSpan &rest = flags.remainingArgs();
+    ASSERT_EQ(3u, rest.size());
+    EXPECT_EQ(argv + 4, rest.begin());
+    EXPECT_STREQ("--x", rest[1]);
+  }
+
+  struct CountFlags: Flags::FlagGroup {
+    Flags::Flag<int> count = Flags::positional(this, "COUNT").required();
+  };
+
+  TEST(FlagsTest, PositionalErrorsUseValueName) {
+    const char *argv[] = { "tool", "abc" };
+    CountFlags flags;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(flags.parseArgs(2, argv));
+    EXPECT_EQ("Invalid value \"abc\" for flag <COUNT>\n",
+              testing::internal::GetCapturedStderr());
+
+    CountFlags missing;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(missing.parseArgs(1, argv));
+    EXPECT_EQ("Flag <COUNT> is required\n",
+              testing::internal::GetCapturedStderr());
+  }
+
+  TEST(FlagsTest, BareValueWithoutPositionalsFails) {
+    const char *argv[] = { "tool", "--level", "2", "stray" };
+    PlainFlags flags;
+    EXPECT_FALSE(flags.parseArgs(4, argv));
+  }
+}
+
+namespace PassthroughTest {
+
+  struct EntityFlags: Flags::FlagGroup {
+    Flags::Flag<int64_t> id = Flags::flag(this, "id");
+    EntityFlags(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct WrapperFlags: Flags::FlagGroup {
+    Flags::Flag<int> jobs = Flags::flag(this, "jobs", 'j');
+    Flags::Switch verbose = Flags::flag(this, 'v');
+    Flags::Flag<vector<EntityFlags>> entities = Flags::flag(this, "entity");
+    Flags::Flag<string> input = Flags::positional(this, "INPUT");
+    WrapperFlags() { passUnknownFlags(); }
+  };
+
+  TEST(FlagsTest, UnknownFlagsPassThrough) {
+    const char *argv[] = {
+      "wrapper", "--opt", "1", "2", "-j", "4", "--level=3", "-q", "-v",
+      "--entity", "--id", "5", "--color", "red", "in.txt"
+    };
+    constexpr int argc = sizeof(argv) / sizeof(*argv);
+    WrapperFlags flags;
+    ASSERT_TRUE(flags.parseArgs(argc, argv));
+    EXPECT_EQ(4, flags.jobs.value);
+    EXPECT_TRUE(flags.verbose.present);
+    ASSERT_EQ(1u, flags.entities.value.size());
+    EXPECT_EQ(5, flags.entities.value[0].id.value);
+
+    // "--color red in.txt" is taken whole, since the unknown flag's values
+    // cannot be told apart from positionals.
+    const vector<Flags::ArgRange> &unknown = flags.unknownArgs();
+    ASSERT_EQ(3u, unknown.size());
+    EXPECT_EQ(1u, unknown[0].first);
+    EXPECT_EQ(3u, unknown[0].count);
+    EXPECT_EQ(6u, unknown[1].first);
+    EXPECT_EQ(2u, unknown[1].count);
+    EXPECT_EQ(12u, unknown[2].first);
+    EXPECT_EQ(3u, unknown[2].count);
+
+    vector<const char*> child = flags.forwardedArgs(argv);
+    ASSERT_EQ(10u, child.size());
+    EXPECT_EQ(argv[0], child[0]);
+    EXPECT_EQ(argv[3], child[3]);
+    EXPECT_EQ(argv[7], child[5]);
+    EXPECT_EQ(argv[14], child[8]);
+    EXPECT_EQ(nullptr, child[9]);
+  }
+
+  TEST(FlagsTest, PassthroughKeepsArgsAfterDoubleDash) {
+    const char *argv[] = { "wrapper", "--opt=x", "in", "--", "-v", "out" };
+    WrapperFlags flags;
+    ASSERT_TRUE(flags.parseArgs(6, argv));
+    EXPECT_EQ("in", flags.input.value);
+    vector<const char*> child = flags.forwardedArgs(argv);
+    ASSERT_EQ(6u, child.size());
+    EXPECT_EQ(argv[1], child[1]);
+    EXPECT_STREQ("--", child[2]);
+    EXPECT_EQ(argv[4], child[3]);
+    EXPECT_EQ(argv[5], child[4]);
+  }
+
+  TEST(FlagsTest, PassthroughRejectsWhatItCannotForward) {
+    // Part of a chain of short flags cannot be forwarded without copying.
+    const char *chain[] = { "wrapper", "-vq" };
+    WrapperFlags chained;
+    EXPECT_FALSE(chained.parseArgs(2, chain));
+
+    // A known flag given too often is still an error.
+    const char *twice[] = { "wrapper", "-j", "1", "-j", "2" };
+    WrapperFlags repeated;
+    EXPECT_FALSE(repeated.parseArgs(5, twice));
+  }
+}
+
+namespace MultiParserTest {
+
+  struct EntityFlags: Flags::FlagGroup {
+    Flags::Flag<int64_t> id = Flags::flag(this, "id");
+    Flags::Flag<double> x = Flags::flag(this, "x", 'x');
+    EntityFlags(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct NetworkFlags: Flags::FlagGroup {
+    Flags::Flag<int> port = Flags::flag(this, "port", 'p');
+    Flags::Flag<vector<string>> hosts = Flags::flag(this, "host");
+  };
+
+  struct RenderFlags: Flags::FlagGroup {
+    Flags::Flag<vector<EntityFlags>> entities = Flags::flag(this, "entity");
+    Flags::Switch verbose = Flags::flag(this, 'v');
+    Flags::Flag<string> scene = Flags::positional(this, "SCENE");
+  };
+
+  struct LoggingFlags: Flags::FlagGroup {
+    Flags::Flag<int> level = Flags::flag(this, "level");
+    Flags::Switch verbose = Flags::flag(this, "verbose", 'v');
+    Flags::Flag<int> port = Flags::flag(this, "port");
+  };
+
+  TEST(FlagsTest, MultiParserDispatchesToOwners) {
+    const char *argv[] = {
+      "tool", "--host", "a", "b", "--entity", "--id", "3", "-x", "1.5",
+      "scene.txt", "-p", "80", "--entity", "--id=4", "-v"
+    };
+    constexpr int argc = sizeof(argv) / sizeof(*argv);
+    NetworkFlags network;
+    RenderFlags render;
+    Flags::MultiParser parser({ &network, &render });
+    EXPECT_TRUE(parser.conflicts().empty());
+    ASSERT_TRUE(parser.parseArgs(argc, argv));
+    EXPECT_EQ(80, network.port.value);
+    EXPECT_EQ(vector<string>({ "a", "b" }), network.hosts.value);
+    ASSERT_EQ(2u, render.entities.value.size());
+    EXPECT_EQ(3, render.entities.value[0].id.value);
+    EXPECT_EQ(1.5, render.entities.value[0].x.value);
+    EXPECT_EQ(4, render.entities.value[1].id.value);
+    EXPECT_EQ("scene.txt", render.scene.value);
+    EXPECT_TRUE(render.verbose.present);
+  }
+
+  TEST(FlagsTest, MultiParserReportsConflicts) {
+    NetworkFlags network;
+    RenderFlags render;
+    LoggingFlags logging;
+    Flags::MultiParser parser({ &network, &render, &logging });
+    EXPECT_EQ(vector<string>({ "\"port\"", "'v'" }), parser.conflicts());
+
+    // A conflicting flag goes to the first group which declares it.
+    const char *argv[] = { "tool", "--port", "1", "-v", "--level", "2" };
+    ASSERT_TRUE(parser.parseArgs(6, argv));
+    EXPECT_EQ(1, network.port.value);
+    EXPECT_TRUE(render.verbose.present);
+    EXPECT_FALSE(logging.verbose.present);
+    EXPECT_EQ(2, logging.level.value);
+  }
+
+  TEST(FlagsTest, MultiParserRejectsUnknownFlags) {
+    NetworkFlags network;
+    LoggingFlags logging;
+    Flags::MultiParser parser({ &network, &logging });
+    const char *unknown[] = { "tool", "--port", "1", "--color", "red" };
+    EXPECT_FALSE(parser.parseArgs(5, unknown));
+
+    parser.reset();
+    const char *twice[] = { "tool", "--level", "1", "--level", "2" };
+    EXPECT_FALSE(parser.parseArgs(5, twice));
+
+    parser.reset();
+    const char *rest[] = { "tool", "--level", "1", "--", "a", "b" };
+    ASSERT_TRUE(parser.parseArgs(6, rest));
+    EXPECT_EQ(2u, parser.remainingArgs().size());
+  }
+}
+
+namespace FixedArityTest {
+
+  struct ShapeFlags: Flags::FlagGroup {
+    Flags::Flag<std::tuple<double, double>> point =
+        Flags::flag(this, "point", 'p');
+    Flags::Flag<std::tuple<string, int, bool>> entry =
+        Flags::flag(this, "entry");
+    Flags::Flag<std::array<uint8_t, 3>> rgb = Flags::flag(this, "rgb");
+    Flags::Switch verbose = Flags::flag(this, 'v');
+  };
+
+  TEST(FlagsTest, TupleAndArrayFlagsTakeFixedArity) {
+    const char *argv[] = {
+      "flagstest.exe", "--point", "1.5", "-2.5", "--entry=name", "7", "yes",
+      "--rgb", "255", "128", "0", "-v"
+    };
+    constexpr int argc = sizeof(argv) / sizeof(*argv);
+    ShapeFlags flags;
+    ASSERT_TRUE(flags.parseArgs(argc, argv));
+    EXPECT_EQ(std::make_tuple(1.5, -2.5), flags.point.value);
+    EXPECT_EQ(std::make_tuple(string("name"), 7, true), flags.entry.value);
+    EXPECT_EQ((std::array<uint8_t, 3> { 255, 128, 0 }), flags.rgb.value);
+    EXPECT_TRUE(flags.verbose.present);
+  }
+
+  TEST(FlagsTest, TupleAndArrayFlagsRejectBadArity) {
+    for (auto args : {
+        vector<const char*> { "flagstest.exe", "--point", "1.5" },
+        vector<const char*> { "flagstest.exe", "--rgb", "1", "2", "256" },
+        vector<const char*> { "flagstest.exe", "-p", "1", "x" },
+        vector<const char*> { "flagstest.exe", "-p", "1", "2", "3" },
+        vector<const char*> { "flagstest.exe", "-p", "1", "2", "-p", "3", "4" },
+    }) {
+      ShapeFlags flags;
+      EXPECT_FALSE(flags.parseArgs(args.size(), args.data())) << args[2];
+    }
+  }
+
+  struct RestrictedShape: Flags::FlagGroup {
+    Flags::Flag<std::array<int, 2>> size =
+        Flags::flag(this, "size").range(0, 10);
+  };
+
+  TEST(FlagsTest, TupleAndArrayFlagsRejectRestrictions) {
+    testing::internal::CaptureStderr();
+    RestrictedShape flags;
+    EXPECT_EQ("Internal error: flag \"size\" does not support range() or "
+              "oneOf()\n", testing::internal::GetCapturedStderr());
+    const char *argv[] = { "flagstest.exe", "--size", "1", "2" };
+    EXPECT_FALSE(flags.parseArgs(4, argv));
+  }
+}
+
+namespace EnumTest {
+  enum class Color { kRed, kGreen, kBlue };
+  enum class Level { kDebug, kInfo, kWarning, kError };
+}
+
+template<> struct Flags::EnumNames<EnumTest::Color> {
+  static constexpr Flags::EnumName<EnumTest::Color> values[] = {
+    { "red", EnumTest::Color::kRed },
+    { "green", EnumTest::Color::kGreen },
+    { "blue", EnumTest::Color::kBlue },
+  };
+};
+
+template<> struct Flags::EnumNames<EnumTest::Level> {
+  static constexpr Flags::EnumName<EnumTest::Level> values[] = {
+    { "debug", EnumTest::Level::kDebug },
+    { "info", EnumTest::Level::kInfo },
+    { "warning", EnumTest::Level::kWarning },
+    { "warn", EnumTest::Level::kWarning },
+    { "error", EnumTest::Level::kError },
+  };
+};
+
+namespace EnumTest {
+
+  struct StyleFlags: Flags::FlagGroup {
+    Flags::Flag<Color> color = Flags::flag(this, "color", 'c');
+    Flags::Flag<vector<Level>> levels = Flags::flag(this, "level");
+    Flags::Flag<std::optional<int>> width = Flags::flag(this, "width");
+    Flags::Flag<std::optional<int>> height = Flags::flag(this, "height");
+    Flags::Flag<std::variant<int, double, Color, string>> size =
+        Flags::flag(this, "size", 's');
+  };
+
+  TEST(FlagsTest, EnumOptionalAndVariantFlags) {
+    const char *argv[] = {
+      "flagstest.exe", "-c", "green", "--level", "warn", "error", "debug",
+      "--width=80", "--size", "2.5"
+    };
+    constexpr int argc = sizeof(argv) / sizeof(*argv);
+    StyleFlags flags;
+    ASSERT_TRUE(flags.parseArgs(argc, argv));
+    EXPECT_EQ(Color::kGreen, flags.color.value);
+    EXPECT_EQ(vector<Level>({ Level::kWarning, Level::kError, Level::kDebug }),
+              flags.levels.value);
+    EXPECT_EQ(std::optional<int>(80), flags.width.value);
+    EXPECT_FALSE(flags.height.value.has_value());
+    EXPECT_EQ(1u, flags.size.value.index());
+    EXPECT_EQ(2.5, std::get<double>(flags.size.value));
+  }
+
+  TEST(FlagsTest, VariantTriesAlternativesInOrder) {
+    for (auto test : {
+        std::make_pair("12", 0u), std::make_pair("1e3", 1u),
+        std::make_pair("blue", 2u), std::make_pair("huge", 3u) }) {
+      const char *argv[] = { "flagstest.exe", "-s", test.first };
+      StyleFlags flags;
+      ASSERT_TRUE(flags.parseArgs(3, argv)) << test.first;
+      EXPECT_EQ(test.second, flags.size.value.index()) << test.first;
+    }
+  }
+
+  TEST(FlagsTest, EnumFlagsRejectUnknownNames) {
+    for (const char *name : { "Red", "gree", "greenish", "", "0" }) {
+      const char *argv[] = { "flagstest.exe", "--color", name };
+      StyleFlags flags;
+      EXPECT_FALSE(flags.parseArgs(3, argv)) << name;
+    }
+    const char *argv[] = { "flagstest.exe", "--level", "info", "loud" };
+    StyleFlags flags;
+    EXPECT_FALSE(flags.parseArgs(4, argv));
+  }
+
+  TEST(FlagsTest, EnumHelpListsNames) {
+    std::stringstream help;
+    StyleFlags().printHelp(help);
+    EXPECT_NE(string::npos, help.str().find("red|green|blue"));
+  }
+}
+
+namespace EnumSetTest {
+  using EnumTest::Level;
+
+  struct MaskFlags: Flags::FlagGroup {
+    Flags::Flag<Flags::EnumSet<Level>> levels = Flags::flag(this, "levels");
+    Flags::Flag<Flags::EnumSet<Level>> quiet =
+        Flags::flag(this, "quiet", 'q').splitOn(',');
+    Flags::Flag<vector<bool>> bits = Flags::flag(this, "bits");
+  };
+
+  TEST(FlagsTest, EnumSetFlagsSetBits) {
+    const char *argv[] = {
+      "flagstest.exe", "--levels", "warn", "error", "-q", "debug,info",
+      "--levels=warning"
+    };
+    MaskFlags flags;
+    ASSERT_TRUE(flags.parseArgs(7, argv));
+    const Flags::EnumSet<Level> expected = { Level::kWarning, Level::kError };
+    EXPECT_EQ(expected, flags.levels.value);
+    EXPECT_EQ(2u, flags.levels.value.size());
+    EXPECT_EQ(0xCu, flags.levels.value.word(0));
+    EXPECT_TRUE(flags.levels.value.containsAll({ Level::kError }));
+    EXPECT_FALSE(flags.levels.value.intersects(flags.quiet.value));
+    EXPECT_EQ((Flags::EnumSet<Level> { Level::kDebug, Level::kInfo }),
+              ~flags.levels.value);
+    EXPECT_TRUE(flags.quiet.value.contains(Level::kInfo));
+
+    const char *bad[] = { "flagstest.exe", "-q", "debug,loud" };
+    MaskFlags rejected;
+    EXPECT_FALSE(rejected.parseArgs(3, bad));
+  }
+
+  TEST(FlagsTest, BoolListsAcceptEachSpelling) {
+    const char *argv[] = {
+      "flagstest.exe", "--bits", "1", "ON", "Yes", "true", "0", "no", "oFF",
+      "FALSE"
+    };
+    MaskFlags flags;
+    ASSERT_TRUE(flags.parseArgs(10, argv));
+    EXPECT_EQ(vector<bool>({ true, true, true, true, false, false, false,
+                             false }), flags.bits.value);
+
+    for (const char *text : { "", "2", "truee", "tru", "\x11", "o" }) {
+      const char *bad[] = { "flagstest.exe", "--bits", text };
+      MaskFlags rejected;
+      EXPECT_FALSE(rejected.parseArgs(3, bad)) << text;
+    }
+  }
+}
+
+namespace MapTest {
+
+  struct DefineFlags: Flags::FlagGroup {
+    Flags::Flag<std::map<string, int>> defines =
+        Flags::flag(this, "define", 'D');
+    Flags::Flag<std::unordered_map<string, string>> env =
+        Flags::flag(this, "env").onDuplicateKey(Flags::DuplicateKeys::kError);
+    Flags::Flag<Flags::FlatMap<string, double>> weights =
+        Flags::flag(this, "weight").splitOn(',');
+    Flags::Flag<Flags::FlatMap<int, string>> names =
+        Flags::flag(this, "name")
+            .onDuplicateKey(Flags::DuplicateKeys::kFirstWins);
+  };
+
+  static bool parse(std::initializer_list<const char*> args,
+                    DefineFlags &flags) {
+    vector<const char*> argv = { "flagstest.exe" };
+    argv.insert(argv.end(), args);
+    return flags.parseArgs(argv.size(), argv.data());
+  }
+
+  TEST(FlagsTest, MapFlagsTakeKeyValuePairs) {
+    DefineFlags flags;
+    ASSERT_TRUE(parse({ "--define", "B=2", "A=1", "-D", "B=3", "--define=C=7",
+                        "--env", "HOME=/root", "PATH=/bin:/usr/bin=x",
+                        "--weight=z=0.5,a=1.5", "--weight", "m=2,a=-1",
+                        "--name", "2=two", "1=one", "2=deux" }, flags));
+    EXPECT_EQ((std::map<string, int> { { "A", 1 }, { "B", 3 }, { "C", 7 } }),
+              flags.defines.value);
+    EXPECT_EQ("/bin:/usr/bin=x", flags.env.value.at("PATH"));
+
+    const auto &weights = flags.weights.value;
+    ASSERT_EQ(3u, weights.size());
+    EXPECT_EQ("a", weights.begin()->first);
+    EXPECT_EQ(-1, weights.find("a")->second);
+    EXPECT_EQ(2, weights.find(string("m"))->second);
+    EXPECT_FALSE(weights.contains("q"));
+
+    ASSERT_EQ(2u, flags.names.value.size());
+    EXPECT_EQ("two", flags.names.value.find(2)->second);
+  }
+
+  TEST(FlagsTest, MapFlagsRejectBadPairs) {
+    for (auto args : {
+        std::initializer_list<const char*> { "--define", "A" },
+        std::initializer_list<const char*> { "--define", "A=x" },
+        std::initializer_list<const char*> { "--env", "A=1", "A=2" },
+        std::initializer_list<const char*> { "--env=A=1", "--env", "A=1" },
+    }) {
+      DefineFlags flags;
+      EXPECT_FALSE(parse(args, flags)) << *std::next(args.begin());
+    }
+  }
+
+  struct StrictWeights: Flags::FlagGroup {
+    Flags::Flag<Flags::FlatMap<string, int>> weights =
+        Flags::flag(this, "w").onDuplicateKey(Flags::DuplicateKeys::kError);
+  };
+
+  TEST(FlagsTest, FlatMapReportsRepeatedKeys) {
+    const char *argv[] = { "flagstest.exe", "--w", "a=1", "b=2", "--w", "a=3" };
+    StrictWeights flags;
+    EXPECT_FALSE(flags.parseArgs(6, argv));
+  }
+}
+
+namespace StringListTest {
+
+  struct InputFlags: Flags::FlagGroup {
+    Flags::Flag<Flags::StringList> inputs = Flags::flag(this, "input", 'i');
+    Flags::Flag<Flags::StringList> tags =
+        Flags::flag(this, "tag").splitOn(',');
+    Flags::Switch verbose = Flags::flag(this, 'v');
+  };
+
+  TEST(FlagsTest, StringListStoresValuesEndToEnd) {
+    const char *argv[] = {
+      "flagstest.exe", "--input", "a.txt", "", "dir/b.txt", "-v",
+      "-i", "c.txt", "--tag=x,,yz"
+    };
+    InputFlags flags;
+    ASSERT_TRUE(flags.parseArgs(9, argv));
+    const Flags::StringList &inputs = flags.inputs.value;
+    EXPECT_EQ(vector<std::string_view>({ "a.txt", "", "dir/b.txt", "c.txt" }),
+              vector<std::string_view>(inputs.begin(), inputs.end()));
+    EXPECT_STREQ("dir/b.txt", inputs.c_str(2));
+    EXPECT_EQ("c.txt", inputs.back());
+    EXPECT_EQ(5u + 0 + 9 + 5 + 4, inputs.characters());
+    EXPECT_EQ(3, std::find(inputs.begin(), inputs.end(), "c.txt")
+                 - inputs.begin());
+    EXPECT_EQ(vector<std::string_view>({ "x", "", "yz" }),
+              vector<std::string_view>(flags.tags.value.begin(),
+                                       flags.tags.value.end()));
+    EXPECT_TRUE(flags.verbose.present);
+  }
+
+#ifndef DEEPFLAGS_NO_REGEX
+  struct CheckedInputs: Flags::FlagGroup {
+    Flags::Flag<Flags::StringList> inputs =
+        Flags::flag(this, "input").matches(".*\\.txt");
+  };
+
+  TEST(FlagsTest, StringListChecksEachValue) {
+    const char *argv[] = { "flagstest.exe", "--input", "a.txt", "b.csv" };
+    CheckedInputs flags;
+    EXPECT_FALSE(flags.parseArgs(4, argv));
+    EXPECT_EQ(1u, flags.inputs.value.size());
+  }
+#endif
+}
+
+namespace InternTest {
+
+  struct Label: Flags::FlagGroup {
+    Flags::Flag<Flags::InternedString> label = Flags::flag(this, "label", 'l');
+    Flags::Flag<int> width = Flags::flag(this, "width", 'w');
+    Label(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct LabelFlags: Flags::FlagGroup {
+    Flags::Flag<vector<Label>> displays = Flags::flag(this, "display", 'D');
+    Flags::Flag<Flags::InternedString> title = Flags::flag(this, "title");
+  };
+
+  TEST(FlagsTest, InternedValuesShareOneCopy) {
+    vector<string> args = {
+      "flagstest.exe", "-D", "-l", "left", "-w", "1", "-D", "--label=right",
+      "-D", "-l", "left", "-D", "-w", "4", "--title", "right"
+    };
+    vector<const char*> argv;
+    for (const string &arg : args) {
+      argv.push_back(arg.c_str());
+    }
+    LabelFlags flags;
+    ASSERT_TRUE(flags.parseArgs(argv.size(), argv.data()));
+    // The values are copies, which outlive the arguments.
+    args.assign(args.size(), string(32, '#'));
+    
+    const vector<Label> &displays = flags.displays.value;
+    ASSERT_EQ(4u, displays.size());
+    EXPECT_EQ("left", displays[0].label.value.view());
+    EXPECT_STREQ("right", displays[1].label.value.c_str());
+    EXPECT_EQ(displays[0].label.value.view().data(),
+              displays[2].label.value.view().data());
+    EXPECT_TRUE(displays[0].label.value == displays[2].label.value);
+    EXPECT_TRUE(displays[1].label.value == flags.title.value);
+    EXPECT_TRUE(displays[0].label.value != displays[1].label.value);
+    EXPECT_FALSE(displays[3].label.present);
+    EXPECT_TRUE(displays[3].label.value.empty());
+    EXPECT_TRUE(displays[3].label.value != displays[0].label.value);
+  }
+
+  TEST(FlagsTest, InternedValuesBelongToTheirParse) {
+    const char *argv[] = { "flagstest.exe", "--title", "same" };
+    LabelFlags first, second;
+    ASSERT_TRUE(first.parseArgs(3, argv));
+    ASSERT_TRUE(second.parseArgs(3, argv));
+    EXPECT_EQ(first.title.value.view(), second.title.value.view());
+    EXPECT_TRUE(first.title.value != second.title.value);
+    
+    first.reset();
+    EXPECT_FALSE(first.title.present);
+    EXPECT_TRUE(first.title.value.empty());
+    ASSERT_TRUE(first.parseArgs(3, argv));
+    EXPECT_EQ("same", first.title.value.view());
+  }
+}
+
+namespace StreamTest {
+
+  struct PrefetchFlags: Flags::FlagGroup {
+    Flags::Flag<Flags::Stream<std::string_view>> prefetch =
+        Flags::flag(this, "prefetch", 'p');
+    Flags::Flag<Flags::Stream<int>> sizes =
+        Flags::flag(this, "size").splitOn(',').range(1, 100);
+    Flags::Switch verbose = Flags::flag(this, 'v');
+  };
+
+  TEST(FlagsTest, StreamPassesEachValueToItsHandler) {
+    const char *argv[] = {
+      "flagstest.exe", "--prefetch", "a.bin", "b.bin", "-v", "-p", "c.bin",
+      "--size=3,4", "5"
+    };
+    PrefetchFlags flags;
+    vector<string> queued;
+    int total = 0;
+    flags.prefetch.onValue([&](std::string_view path) {
+      queued.push_back(string(path));
+    });
+    flags.sizes.onValue([&](int size) { total += size; });
+    ASSERT_TRUE(flags.parseArgs(9, argv));
+    EXPECT_EQ(vector<string>({ "a.bin", "b.bin", "c.bin" }), queued);
+    EXPECT_EQ(3u, flags.prefetch.count);
+    EXPECT_EQ(12, total);
+    EXPECT_EQ(3u, flags.sizes.count);
+    EXPECT_TRUE(flags.verbose.present);
+    
+    flags.reset();
+    EXPECT_FALSE(flags.prefetch.present);
+    EXPECT_EQ(0u, flags.prefetch.count);
+    ASSERT_TRUE(flags.parseArgs(3, argv));
+    EXPECT_EQ("a.bin", queued.back());
+  }
+
+  TEST(FlagsTest, StreamStopsAtRejectedValues) {
+    PrefetchFlags flags;
+    vector<int> seen;
+    flags.sizes.onValue([&](int size) {
+      seen.push_back(size);
+      return size != 13;
+    });
+    const char *outOfRange[] = { "flagstest.exe", "--size", "2,200,3" };
+    EXPECT_FALSE(flags.parseArgs(3, outOfRange));
+    EXPECT_EQ(vector<int>({ 2 }), seen);
+    
+    flags.reset();
+    seen.clear();
+    const char *refused[] = { "flagstest.exe", "--size", "12", "13", "14" };
+    EXPECT_FALSE(flags.parseArgs(5, refused));
+    EXPECT_EQ(vector<int>({ 12, 13 }), seen);
+    EXPECT_EQ(1u, flags.sizes.count);
+    
+    // Without a handler, values are only checked and counted.
+    PrefetchFlags unhandled;
+    const char *argv[] = { "flagstest.exe", "--size", "1,2", "--size=x" };
+    EXPECT_FALSE(unhandled.parseArgs(4, argv));
+    EXPECT_EQ(2u, unhandled.sizes.count);
+    
+    // A flag whose only value was refused was never given.
+    PrefetchFlags rejected;
+    const char *first[] = { "flagstest.exe", "--size", "200" };
+    EXPECT_FALSE(rejected.parseArgs(3, first));
+    EXPECT_FALSE(rejected.sizes.present);
+    EXPECT_EQ(0u, rejected.sizes.count);
+  }
+}
+
+namespace AsyncCheckTest {
+
+  /// Stands in for DNS: knows a few hosts, and takes a while to answer.
+  class ResolverStub {
+    std::atomic<int> running { 0 };
+
+   public:
+    std::atomic<int> calls { 0 };
+    std::atomic<int> mostAtOnce { 0 };
+
+    std::string resolve(std::string_view host) {
+      ++calls;
+      int now = ++running;
+      for (int most = mostAtOnce; now > most
+           && !mostAtOnce.compare_exchange_weak(most, now);) {}
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      --running;
+      if (host == "localhost" || host == "example.com") {
+        return "";
+      }
+      return "host not found";
+    }
+  };
+
+  static ResolverStub resolver;
+
+  static std::string resolve(std::string_view host) {
+    return resolver.resolve(host);
+  }
+
+  struct Endpoint: Flags::FlagGroup {
+    Flags::Flag<std::string> host =
+        Flags::flag(this, "host").checkAsync(resolve);
+    Flags::Flag<int> port = Flags::flag(this, "port").range(1, 65535);
+    Endpoint(CtorArgs args): FlagGroup(args) {}
+  };
+
+  struct ServerFlags: Flags::FlagGroup {
+    Flags::Flag<vector<std::string>> peers =
+        Flags::flag(this, "peer").checkAsync(resolve);
+    Flags::Flag<vector<Endpoint>> endpoints = Flags::flag(this, "endpoint");
+    Flags::Flag<Flags::Stream<std::string_view>> mirrors =
+        Flags::flag(this, "mirror").checkAsync(resolve);
+  };
+
+  TEST(FlagsTest, AsyncChecksRunWhileParsing) {
+    const char *argv[] = {
+      "flagstest.exe", "--peer", "localhost", "example.com", "localhost",
+      "example.com", "localhost", "example.com", "localhost", "example.com",
+      "--endpoint", "--host=localhost", "--port=80",
+      "--mirror", "example.com"
+    };
+    resolver.calls = 0;
+    resolver.mostAtOnce = 0;
+    ServerFlags flags;
+    ASSERT_TRUE(flags.parseArgs(15, argv));
+    EXPECT_EQ(10, resolver.calls);
+    EXPECT_LE(resolver.mostAtOnce, DEEPFLAGS_CHECK_THREADS);
+#ifndef DEEPFLAGS_NO_THREADS
+    EXPECT_GT(resolver.mostAtOnce, 1);
+#endif
+    EXPECT_EQ(8u, flags.peers.value.size());
+    EXPECT_EQ("localhost", flags.endpoints.value[0].host.value);
+  }
+
+  TEST(FlagsTest, AsyncCheckFailuresAreReportedTogether) {
+    const char *argv[] = {
+      "flagstest.exe", "--peer", "nowhere", "localhost", "elsewhere",
+      "--endpoint", "--host=gone", "--mirror", "missing"
+    };
+    resolver.calls = 0;
+    ServerFlags flags;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(flags.parseArgs(9, argv));
+    EXPECT_EQ(
+        "Invalid value \"nowhere\" for flag \"peer\" (value #1): "
+        "host not found\n"
+        "Invalid value \"elsewhere\" for flag \"peer\" (value #3): "
+        "host not found\n"
+        "Invalid value \"gone\" for flag \"host\": host not found\n"
+        "Invalid value \"missing\" for flag \"mirror\" (value #1): "
+        "host not found\n",
+        testing::internal::GetCapturedStderr());
+    EXPECT_EQ(5, resolver.calls);
+    
+    // Checks already started finish even when parsing fails.
+    resolver.calls = 0;
+    const char *badPort[] = {
+      "flagstest.exe", "--peer", "nowhere", "--endpoint", "--port=0"
+    };
+    ServerFlags again;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(again.parseArgs(5, badPort));
+    EXPECT_EQ(
+        "Invalid value \"0\" for flag \"port\": "
+        "must be between 1 and 65535\n"
+        "Invalid value \"nowhere\" for flag \"peer\" (value #1): "
+        "host not found\n",
+        testing::internal::GetCapturedStderr());
+    EXPECT_EQ(1, resolver.calls);
+  }
+
+  static std::string throwInt(std::string_view) {
+    throw 7;
+  }
+
+  struct ThrowingCheck: Flags::FlagGroup {
+    Flags::Flag<std::string> name =
+        Flags::flag(this, "name").checkAsync(throwInt);
+  };
+
+  struct MapCheck: Flags::FlagGroup {
+    Flags::Flag<std::map<string, int>> defines =
+        Flags::flag(this, "define").checkAsync(resolve);
+  };
+
+  TEST(FlagsTest, AsyncChecksFailSafely) {
+    ThrowingCheck flags;
+    const char *named[] = { "flagstest.exe", "--name", "x" };
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(flags.parseArgs(3, named));
+    EXPECT_EQ("Invalid value \"x\" for flag \"name\": "
+              "check failed with an unknown exception\n",
+              testing::internal::GetCapturedStderr());
+
+    testing::internal::CaptureStderr();
+    MapCheck unsupported;
+    EXPECT_EQ("Internal error: flag \"define\" does not support "
+              "checkAsync()\n", testing::internal::GetCapturedStderr());
+    const char *argv[] = { "flagstest.exe", "--define", "a=1" };
+    EXPECT_FALSE(unsupported.parseArgs(3, argv));
+  }
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+namespace PathTest {
+
+  /// A temporary directory holding the given empty files.
+  class TempFiles {
+    string root;
+    vector<string> files;
+
+   public:
+    explicit TempFiles(std::initializer_list<string> names) {
+      char pattern[] = "/tmp/deepflagsXXXXXX";
+      root = mkdtemp(pattern);
+      for (const string &name : names) {
+        files.push_back(path(name));
+        fclose(fopen(files.back().c_str(), "w"));
+      }
+    }
+
+    ~TempFiles() {
+      for (const string &file : files) {
+        unlink(file.c_str());
+      }
+      rmdir(root.c_str());
+    }
+
+    string path(const string &name) const {
+      return root + "/" + name;
+    }
+  };
+
+  struct InputFlags: Flags::FlagGroup {
+    Flags::Flag<vector<Flags::Path>> inputs =
+        Flags::flag(this, "input").mustExist();
+    Flags::Flag<Flags::Path> config =
+        Flags::flag(this, "config").mustBeReadable();
+    Flags::Flag<Flags::Path> output = Flags::flag(this, "output");
+  };
+
+  TEST(FlagsTest, PathsAreCheckedTogether) {
+    TempFiles temp({ "a.txt", "b.txt" });
+    const string a = temp.path("a.txt"), b = temp.path("b.txt");
+    const string missing = temp.path("missing.txt");
+    const string underFile = temp.path("a.txt/c.txt");
+    
+    const char *good[] = {
+      "flagstest.exe", "--input", a.c_str(), b.c_str(), "--config",
+      a.c_str(), "--output", missing.c_str()
+    };
+    InputFlags flags;
+    ASSERT_TRUE(flags.parseArgs(8, good));
+    ASSERT_EQ(2u, flags.inputs.value.size());
+    EXPECT_EQ(b, flags.inputs.value[1].str());
+    EXPECT_STREQ(missing.c_str(), flags.output.value.c_str());
+    
+    const char *bad[] = {
+      "flagstest.exe", "--input", a.c_str(), missing.c_str(), b.c_str(),
+      underFile.c_str(), "--config", missing.c_str()
+    };
+    InputFlags checked;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(checked.parseArgs(8, bad));
+    EXPECT_EQ("3 of 5 paths cannot be used:\n"
+              "  \"" + missing + "\" for flag \"input\" (value #2) "
+              "does not exist\n"
+              "  \"" + underFile + "\" for flag \"input\" (value #4) "
+              "does not exist\n"
+              "  \"" + missing + "\" for flag \"config\" does not exist\n",
+              testing::internal::GetCapturedStderr());
+  }
+
+  TEST(FlagsTest, PathChecksCoverLongLists) {
+    TempFiles temp({ "present" });
+    vector<string> args = { "flagstest.exe", "--input" };
+    for (int i = 0; i < 2000; ++i) {
+      args.push_back(temp.path(i % 500 == 7 ? "absent" : "present"));
+    }
+    vector<const char*> argv;
+    for (const string &arg : args) {
+      argv.push_back(arg.c_str());
+    }
+    InputFlags flags;
+    testing::internal::CaptureStderr();
+    EXPECT_FALSE(flags.parseArgs(argv.size(), argv.data()));
+    const string errors = testing::internal::GetCapturedStderr();
+    EXPECT_EQ(0u, errors.find("4 of 2000 paths cannot be used:\n"));
+    EXPECT_NE(string::npos, errors.find("(value #1508) does not exist"));
+    EXPECT_EQ(2000u, flags.inputs.value.size());
+  }
+
+  struct MisusedPathChecks: Flags::FlagGroup {
+    Flags::Flag<string> name = Flags::flag(this, "name").mustExist();
+    Flags::Flag<std::map<string, int>> defines =
+        Flags::flag(this, "define").mustBeReadable();
+  };
+
+  TEST(FlagsTest, PathChecksNeedPathFlags) {
+    testing::internal::CaptureStderr();
+    MisusedPathChecks flags;
+    EXPECT_EQ("Internal error: flag \"name\" does not support mustExist() "
+              "or mustBeReadable()\n"
+              "Internal error: flag \"define\" does not support mustExist() "
+              "or mustBeReadable()\n",
+              testing::internal::GetCapturedStderr());
+    const char *argv[] = { "flagstest.exe", "--define", "a=1" };
+    EXPECT_FALSE(flags.parseArgs(3, argv));
+  }
+
+#ifdef DEEPFLAGS_IO_URING
+  TEST(FlagsTest, StatxRingReportsEachPath) {
+    TempFiles temp({ "here" });
+    const string here = temp.path("here"), gone = temp.path("gone");
+    const char *paths[] = { here.c_str(), gone.c_str(), "/" };
+    Flags::Internal::StatxRing ring(4);
+    if (!ring.ready()) {
+      return;  // The kernel does not allow io_uring here.
+    }
+    // Enough batches to wrap around the ring.
+    for (int batch = 0; batch < 5; ++batch) {
+      Flags::Internal::StatxBuffer buffers[3];
+      int results[3] = { 1, 1, 1 };
+      ASSERT_TRUE(ring.run(paths, buffers, results, 3));
+      EXPECT_EQ(0, results[0]);
+      EXPECT_EQ(-ENOENT, results[1]);
+      EXPECT_EQ(0, results[2]);
+      EXPECT_TRUE(S_ISREG(buffers[0].mode));
+      EXPECT_TRUE(S_ISDIR(buffers[2].mode));
+    }
+  }
+#endif
+
+  TEST(FlagsTest, PathMustBeReadable) {
+    TempFiles temp({ "secret" });
+    const string secret = temp.path("secret");
+    ASSERT_EQ(0, chmod(secret.c_str(), 0));
+    const char *argv[] = { "flagstest.exe", "--config", secret.c_str() };
+    InputFlags flags;
+    testing::internal::CaptureStderr();
+    // Permission bits do not apply to the superuser.
+    EXPECT_EQ(geteuid() == 0, flags.parseArgs(3, argv));
+    const string errors = testing::internal::GetCapturedStderr();
+    if (geteuid()) {
+      EXPECT_NE(string::npos, errors.find("cannot be read"));
+    }
+  }
+}
+#endif